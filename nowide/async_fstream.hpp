@@ -0,0 +1,501 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_ASYNC_FSTREAM_HPP_INCLUDED
+#define NOWIDE_ASYNC_FSTREAM_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/detail/io_thread_pool.hpp>
+#include <nowide/detail/positional_file.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace nowide {
+    ///
+    /// \brief Options for async_filebuf::open
+    ///
+    struct async_filebuf_options
+    {
+        ///
+        /// Size of each buffer in bytes. Default is 64 KiB
+        ///
+        size_t buffer_size;
+        ///
+        /// Maximum number of outstanding read or write requests, each using one buffer. Default is 4
+        ///
+        size_t queue_depth;
+
+        async_filebuf_options() : buffer_size(64 * 1024), queue_depth(4)
+        {}
+    };
+
+    ///
+    /// \brief File buffer doing the reads and writes in a pool of I/O threads
+    ///
+    /// Opened for reading the following buffers are read ahead while the current one is processed.
+    /// Opened for writing each full buffer is written in the background while the next one is filled.
+    /// Up to async_filebuf_options::queue_depth requests are outstanding at the same time,
+    /// so fast storage can work on several of them at once.
+    ///
+    /// The file name is UTF-8 as for nowide::filebuf and the file is always opened in binary mode.
+    /// A file can be opened either for reading or for writing, not both.
+    /// Opened with app every buffer is appended to the end of the file, also when other writers extend it.
+    /// To keep the order only one append is outstanding at a time, so queue_depth has no effect then.
+    /// Errors of background writes are reported by the next write, sync or close
+    ///
+    /// The requests run in the shared detail::io_thread_pool. Using an async_filebuf from a task running in that pool
+    /// can deadlock once all its threads wait for requests themselves.
+    ///
+    class async_filebuf : public std::streambuf
+    {
+        // Non-copyable
+        async_filebuf(const async_filebuf&);
+        async_filebuf& operator=(const async_filebuf&);
+
+        typedef std::char_traits<char> Traits;
+
+    public:
+        async_filebuf() :
+            pool_(&detail::io_thread_pool::instance()), buffer_size_(0), queue_depth_(0), num_buffers_(0), get_pos_(0),
+            next_read_pos_(0), put_pos_(0), read_eof_(false), failed_(false), mode_(std::ios_base::openmode(0))
+        {
+            setg(0, 0, 0);
+            setp(0, 0);
+        }
+        virtual ~async_filebuf()
+        {
+            close();
+        }
+
+        ///
+        /// Open the file \a s, \a mode must contain either in or out (or app) but not both
+        ///
+        async_filebuf* open(const std::string& s,
+                            std::ios_base::openmode mode,
+                            const async_filebuf_options& options = async_filebuf_options())
+        {
+            return open(s.c_str(), mode, options);
+        }
+        ///
+        /// Open the file \a s, \a mode must contain either in or out (or app) but not both
+        ///
+        async_filebuf* open(const char* s,
+                            std::ios_base::openmode mode,
+                            const async_filebuf_options& options = async_filebuf_options())
+        {
+            if(is_open())
+                return NULL;
+            const bool in = (mode & std::ios_base::in) != 0;
+            const bool out = (mode & (std::ios_base::out | std::ios_base::app)) != 0;
+            if(in == out)
+                return NULL;
+            if(!file_.open(s, mode))
+                return NULL;
+            std::streamoff pos = 0;
+            if(mode & (std::ios_base::app | std::ios_base::ate))
+            {
+                pos = file_.size();
+                if(pos < 0)
+                {
+                    file_.close();
+                    return NULL;
+                }
+            }
+            buffer_size_ = (std::max)(options.buffer_size, size_t(1));
+            queue_depth_ = (std::max)(options.queue_depth, size_t(1));
+            get_pos_ = next_read_pos_ = put_pos_ = pos;
+            read_eof_ = failed_ = false;
+            mode_ = mode;
+            return this;
+        }
+        ///
+        /// Write all pending data, wait for all requests and close the file
+        ///
+        async_filebuf* close()
+        {
+            if(!is_open())
+                return NULL;
+            bool res = sync() == 0;
+            discard_reads();
+            if(pbase())
+                free_.push_back(pbase());
+            setp(0, 0);
+            for(size_t i = 0; i < free_.size(); i++)
+                delete[] free_[i];
+            free_.clear();
+            num_buffers_ = 0;
+            if(!file_.close())
+                res = false;
+            mode_ = std::ios_base::openmode(0);
+            return res ? this : NULL;
+        }
+        bool is_open() const
+        {
+            return file_.is_open();
+        }
+
+    protected:
+        virtual int overflow(int c = EOF)
+        {
+            if(!writing())
+                return EOF;
+            if(pptr() > pbase() && !submit_write())
+                return EOF;
+            if(c != EOF)
+            {
+                if(!pbase())
+                {
+                    char* const buffer = acquire_buffer();
+                    if(!buffer)
+                        return EOF;
+                    setp(buffer, buffer + buffer_size_);
+                }
+                *pptr() = Traits::to_char_type(c);
+                pbump(1);
+            }
+            return Traits::not_eof(c);
+        }
+
+        virtual int sync()
+        {
+            if(!writing())
+                return 0;
+            if(pptr() > pbase())
+                submit_write();
+            while(!pending_.empty())
+                complete_oldest_write();
+            const bool result = !failed_;
+            failed_ = false;
+            return result ? 0 : -1;
+        }
+
+        virtual int underflow()
+        {
+            if(!(mode_ & std::ios_base::in))
+                return EOF;
+            if(gptr() < egptr())
+                return Traits::to_int_type(*gptr());
+            if(eback())
+            {
+                get_pos_ += egptr() - eback();
+                free_.push_back(eback());
+                setg(0, 0, 0);
+            }
+            fill_read_ahead();
+            if(pending_.empty())
+                return EOF;
+            request r = std::move(pending_.front());
+            pending_.pop_front();
+            const size_t n = r.result.get();
+            // Short read: End of file or error
+            if(n < r.size)
+                read_eof_ = true;
+            if(n == 0)
+            {
+                free_.push_back(r.buffer);
+                return EOF;
+            }
+            get_pos_ = r.offset;
+            setg(r.buffer, r.buffer, r.buffer + n);
+            fill_read_ahead();
+            return Traits::to_int_type(*gptr());
+        }
+
+        virtual std::streampos seekoff(std::streamoff off,
+                                       std::ios_base::seekdir seekdir,
+                                       std::ios_base::openmode = std::ios_base::in | std::ios_base::out)
+        {
+            if(!is_open())
+                return EOF;
+            if(writing())
+            {
+                if(seekdir == std::ios_base::cur && off == 0)
+                    return put_pos_ + (pptr() - pbase());
+                if(sync() != 0)
+                    return EOF;
+                const std::streamoff pos = target_pos(off, seekdir, put_pos_);
+                if(pos < 0)
+                    return EOF;
+                put_pos_ = pos;
+                return pos;
+            }
+            const std::streamoff cur = get_pos_ + (gptr() - eback());
+            if(seekdir == std::ios_base::cur && off == 0)
+                return cur;
+            const std::streamoff pos = target_pos(off, seekdir, cur);
+            if(pos < 0)
+                return EOF;
+            // Inside the current buffer
+            if(eback() && get_pos_ <= pos && pos <= get_pos_ + (egptr() - eback()))
+            {
+                setg(eback(), eback() + (pos - get_pos_), egptr());
+                return pos;
+            }
+            discard_reads();
+            get_pos_ = next_read_pos_ = pos;
+            read_eof_ = false;
+            return pos;
+        }
+        virtual std::streampos seekpos(std::streampos pos,
+                                       std::ios_base::openmode m = std::ios_base::in | std::ios_base::out)
+        {
+            return seekoff(pos, std::ios_base::beg, m);
+        }
+
+    private:
+        struct request
+        {
+            char* buffer;
+            size_t size;
+            std::streamoff offset;
+            std::future<size_t> result;
+        };
+
+        bool writing() const
+        {
+            return (mode_ & (std::ios_base::out | std::ios_base::app)) != 0;
+        }
+        std::streamoff target_pos(std::streamoff off, std::ios_base::seekdir seekdir, std::streamoff cur) const
+        {
+            switch(seekdir)
+            {
+            case std::ios_base::beg: return off;
+            case std::ios_base::cur: return cur + off;
+            case std::ios_base::end:
+            {
+                const std::streamoff size = file_.size();
+                return (size < 0) ? -1 : size + off;
+            }
+            default: return -1;
+            }
+        }
+        /// Get an unused buffer, NULL if all are in use
+        char* acquire_buffer()
+        {
+            if(free_.empty())
+            {
+                // One for each request and the get/put area
+                if(num_buffers_ > queue_depth_)
+                    return NULL;
+                num_buffers_++;
+                return new char[buffer_size_];
+            }
+            char* const result = free_.back();
+            free_.pop_back();
+            return result;
+        }
+        /// Write the put area in the background
+        bool submit_write()
+        {
+            request r;
+            r.buffer = pbase();
+            r.size = pptr() - pbase();
+            r.offset = put_pos_;
+            put_pos_ += r.size;
+            setp(0, 0);
+            detail::positional_file* const file = &file_;
+            char* const buffer = r.buffer;
+            const size_t size = r.size;
+            const std::streamoff offset = r.offset;
+            if(mode_ & std::ios_base::app)
+            {
+                // The file is opened with O_APPEND, so appends have to be done in order
+                while(!pending_.empty())
+                    complete_oldest_write();
+                r.result = pool_->submit<size_t>([file, buffer, size]() { return file->append(buffer, size); });
+            } else
+            {
+                r.result = pool_->submit<size_t>(
+                  [file, buffer, size, offset]() { return file->write_at(buffer, size, offset); });
+            }
+            pending_.push_back(std::move(r));
+            if(pending_.size() >= queue_depth_ + 1)
+                complete_oldest_write();
+            return !failed_;
+        }
+        void complete_oldest_write()
+        {
+            request& r = pending_.front();
+            if(r.result.get() != r.size)
+                failed_ = true;
+            free_.push_back(r.buffer);
+            pending_.pop_front();
+        }
+        /// Read the following buffers in the background
+        void fill_read_ahead()
+        {
+            while(!read_eof_ && pending_.size() < queue_depth_)
+            {
+                char* const buffer = acquire_buffer();
+                if(!buffer)
+                    break;
+                request r;
+                r.buffer = buffer;
+                r.size = buffer_size_;
+                r.offset = next_read_pos_;
+                next_read_pos_ += buffer_size_;
+                detail::positional_file* const file = &file_;
+                const size_t size = r.size;
+                const std::streamoff offset = r.offset;
+                r.result = pool_->submit<size_t>(
+                  [file, buffer, size, offset]() { return file->read_at(buffer, size, offset); });
+                pending_.push_back(std::move(r));
+            }
+        }
+        /// Wait for and drop all read ahead data and the get area
+        void discard_reads()
+        {
+            while(!pending_.empty())
+            {
+                pending_.front().result.wait();
+                free_.push_back(pending_.front().buffer);
+                pending_.pop_front();
+            }
+            if(eback())
+                free_.push_back(eback());
+            setg(0, 0, 0);
+        }
+
+        detail::io_thread_pool* pool_;
+        detail::positional_file file_;
+        size_t buffer_size_;
+        size_t queue_depth_;
+        size_t num_buffers_;
+        /// Oldest request first
+        std::deque<request> pending_;
+        std::vector<char*> free_;
+        /// File position of eback()
+        std::streamoff get_pos_;
+        std::streamoff next_read_pos_;
+        /// File position of pbase()
+        std::streamoff put_pos_;
+        bool read_eof_;
+        bool failed_;
+        std::ios_base::openmode mode_;
+    };
+
+    ///
+    /// \brief Input stream reading the file with an async_filebuf
+    ///
+    class async_ifstream : public std::istream
+    {
+    public:
+        async_ifstream() : std::istream(NULL)
+        {
+            init(&buf_);
+        }
+        explicit async_ifstream(const char* file_name, const async_filebuf_options& options = async_filebuf_options()) :
+            std::istream(NULL)
+        {
+            init(&buf_);
+            open(file_name, options);
+        }
+        explicit async_ifstream(const std::string& file_name,
+                                const async_filebuf_options& options = async_filebuf_options()) :
+            std::istream(NULL)
+        {
+            init(&buf_);
+            open(file_name, options);
+        }
+        void open(const std::string& file_name, const async_filebuf_options& options = async_filebuf_options())
+        {
+            open(file_name.c_str(), options);
+        }
+        void open(const char* file_name, const async_filebuf_options& options = async_filebuf_options())
+        {
+            if(!buf_.open(file_name, std::ios_base::in, options))
+                setstate(std::ios_base::failbit);
+            else
+                clear();
+        }
+        bool is_open() const
+        {
+            return buf_.is_open();
+        }
+        void close()
+        {
+            if(!buf_.close())
+                setstate(std::ios_base::failbit);
+        }
+        async_filebuf* rdbuf() const
+        {
+            return const_cast<async_filebuf*>(&buf_);
+        }
+
+    private:
+        async_filebuf buf_;
+    };
+
+    ///
+    /// \brief Output stream writing the file with an async_filebuf
+    ///
+    class async_ofstream : public std::ostream
+    {
+    public:
+        async_ofstream() : std::ostream(NULL)
+        {
+            init(&buf_);
+        }
+        explicit async_ofstream(const char* file_name,
+                                std::ios_base::openmode mode = std::ios_base::out,
+                                const async_filebuf_options& options = async_filebuf_options()) :
+            std::ostream(NULL)
+        {
+            init(&buf_);
+            open(file_name, mode, options);
+        }
+        explicit async_ofstream(const std::string& file_name,
+                                std::ios_base::openmode mode = std::ios_base::out,
+                                const async_filebuf_options& options = async_filebuf_options()) :
+            std::ostream(NULL)
+        {
+            init(&buf_);
+            open(file_name, mode, options);
+        }
+        void open(const std::string& file_name,
+                  std::ios_base::openmode mode = std::ios_base::out,
+                  const async_filebuf_options& options = async_filebuf_options())
+        {
+            open(file_name.c_str(), mode, options);
+        }
+        void open(const char* file_name,
+                  std::ios_base::openmode mode = std::ios_base::out,
+                  const async_filebuf_options& options = async_filebuf_options())
+        {
+            if(!buf_.open(file_name, mode | std::ios_base::out, options))
+                setstate(std::ios_base::failbit);
+            else
+                clear();
+        }
+        bool is_open() const
+        {
+            return buf_.is_open();
+        }
+        void close()
+        {
+            if(!buf_.close())
+                setstate(std::ios_base::failbit);
+        }
+        async_filebuf* rdbuf() const
+        {
+            return const_cast<async_filebuf*>(&buf_);
+        }
+
+    private:
+        async_filebuf buf_;
+    };
+} // namespace nowide
+
+#endif
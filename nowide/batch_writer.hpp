@@ -0,0 +1,107 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_BATCH_WRITER_HPP_INCLUDED
+#define NOWIDE_BATCH_WRITER_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/filebuf.hpp>
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace nowide {
+    ///
+    /// \brief Collects writes to many files and writes them in one batch
+    ///
+    /// Data written through the batch_writer is kept in memory until flush() is called or
+    /// the collected data exceeds the limit given to the constructor.
+    /// Then for each file its pending buffer and the collected data are written together
+    /// with a single gathering write (writev) if #NOWIDE_USE_FD_FILEBUF is set,
+    /// without syncing the file.
+    ///
+    /// The files must stay open until the data is flushed.
+    /// Data written directly to a file is written before any data collected for it.
+    ///
+    /// Only available with the replacement filebuf (#NOWIDE_USE_FILEBUF_REPLACEMENT)
+    ///
+    class batch_writer
+    {
+        // Non-copyable
+        batch_writer(const batch_writer&);
+        batch_writer& operator=(const batch_writer&);
+
+    public:
+        ///
+        /// Create a batch_writer which flushes when more than \a max_size bytes are collected
+        ///
+        explicit batch_writer(size_t max_size = 1024 * 1024) : max_size_(max_size), size_(0)
+        {}
+        ///
+        /// Flushes all collected data, errors are ignored
+        ///
+        ~batch_writer()
+        {
+            flush();
+        }
+
+        ///
+        /// Collect \a n bytes from \a s to be written to \a file.
+        /// Returns false if this caused a flush which failed
+        ///
+        bool write(basic_filebuf<char>& file, const char* s, size_t n)
+        {
+            data_[&file].append(s, n);
+            size_ += n;
+            if(size_ > max_size_)
+                return flush();
+            return true;
+        }
+        ///
+        /// Collect \a data to be written to \a file.
+        /// Returns false if this caused a flush which failed
+        ///
+        bool write(basic_filebuf<char>& file, const std::string& data)
+        {
+            return write(file, data.data(), data.size());
+        }
+
+        ///
+        /// Write all collected data. Returns false if writing to any file failed,
+        /// the other files are still written
+        ///
+        bool flush()
+        {
+            bool result = true;
+            for(std::map<basic_filebuf<char>*, std::string>::iterator it = data_.begin(); it != data_.end(); ++it)
+            {
+                if(!it->first->write_gathered(it->second.data(), it->second.size()))
+                    result = false;
+            }
+            data_.clear();
+            size_ = 0;
+            return result;
+        }
+        ///
+        /// Number of bytes collected and not yet written
+        ///
+        size_t size() const
+        {
+            return size_;
+        }
+
+    private:
+        size_t max_size_;
+        size_t size_;
+        std::map<basic_filebuf<char>*, std::string> data_;
+    };
+} // namespace nowide
+
+#endif
+
+#endif
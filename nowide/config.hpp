@@ -39,4 +39,14 @@
 #define NOWIDE_USE_FILEBUF_REPLACEMENT 0
 #endif
 
+// Implement the replacement filebuf over POSIX file descriptors instead of C stdio
+#if defined(NOWIDE_WINDOWS)
+#ifdef NOWIDE_USE_FD_FILEBUF
+#undef NOWIDE_USE_FD_FILEBUF
+#endif
+#define NOWIDE_USE_FD_FILEBUF 0
+#elif !defined(NOWIDE_USE_FD_FILEBUF)
+#define NOWIDE_USE_FD_FILEBUF 0
+#endif
+
 #endif
@@ -0,0 +1,111 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_DETAIL_BACKGROUND_WRITER_HPP_INCLUDED
+#define NOWIDE_DETAIL_BACKGROUND_WRITER_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace nowide {
+    namespace detail {
+        ///
+        /// \brief Writes one block of data at a time in a background thread
+        ///
+        /// Used by basic_filebuf to write a full buffer while the next one is filled.
+        /// Only one block can be in flight, start() must not be called before wait()
+        ///
+        class background_writer
+        {
+        public:
+            /// Function doing the actual write, returns the number of bytes written
+            typedef size_t (*write_function)(void* context, const char* s, size_t n);
+
+            background_writer(write_function write, void* context) :
+                write_(write), context_(context), data_(NULL), size_(0), pending_(false), failed_(false), stop_(false),
+                thread_(&background_writer::run, this)
+            {}
+            ~background_writer()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                cv_.notify_all();
+                thread_.join();
+            }
+
+            ///
+            /// Start writing \a n bytes from \a s. The data must stay valid until wait() returns
+            ///
+            void start(const char* s, size_t n)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    data_ = s;
+                    size_ = n;
+                    pending_ = true;
+                }
+                cv_.notify_all();
+            }
+            ///
+            /// Wait until the current write is done.
+            /// Return false if any write since the last call to wait() failed
+            ///
+            bool wait()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while(pending_)
+                    cv_.wait(lock);
+                const bool result = !failed_;
+                failed_ = false;
+                return result;
+            }
+
+        private:
+            background_writer(const background_writer&);
+            void operator=(const background_writer&);
+
+            void run()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for(;;)
+                {
+                    while(!pending_ && !stop_)
+                        cv_.wait(lock);
+                    if(!pending_)
+                        return;
+                    const char* const s = data_;
+                    const size_t n = size_;
+                    lock.unlock();
+                    const bool ok = write_(context_, s, n) == n;
+                    lock.lock();
+                    if(!ok)
+                        failed_ = true;
+                    pending_ = false;
+                    cv_.notify_all();
+                }
+            }
+
+            write_function write_;
+            void* context_;
+            const char* data_;
+            size_t size_;
+            bool pending_;
+            bool failed_;
+            bool stop_;
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            std::thread thread_; // Must be last, it uses all other members
+        };
+    } // namespace detail
+} // namespace nowide
+
+#endif
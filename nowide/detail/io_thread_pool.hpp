@@ -0,0 +1,106 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_DETAIL_IO_THREAD_POOL_HPP_INCLUDED
+#define NOWIDE_DETAIL_IO_THREAD_POOL_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nowide {
+    namespace detail {
+        ///
+        /// \brief Pool of threads running blocking I/O requests
+        ///
+        /// Used so that multiple requests to the same or different files can be outstanding at the same time.
+        /// Tasks must not wait for other tasks of the same pool, that deadlocks once all threads are waiting
+        ///
+        class io_thread_pool
+        {
+        public:
+            explicit io_thread_pool(unsigned num_threads) : stop_(false)
+            {
+                for(unsigned i = 0; i < num_threads; i++)
+                    threads_.push_back(std::thread(&io_thread_pool::run, this));
+            }
+            ~io_thread_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                cv_.notify_all();
+                for(size_t i = 0; i < threads_.size(); i++)
+                    threads_[i].join();
+            }
+
+            ///
+            /// Shared pool used by default. Has at least 4 threads as the threads mostly wait for I/O
+            ///
+            static io_thread_pool& instance()
+            {
+                static io_thread_pool pool((std::max)(std::thread::hardware_concurrency(), 4u));
+                return pool;
+            }
+
+            ///
+            /// Run \a f in one of the threads, the result (or exception) is available through the returned future
+            ///
+            template<typename Result>
+            std::future<Result> submit(const std::function<Result()>& f)
+            {
+                const std::shared_ptr<std::packaged_task<Result()> > task =
+                  std::make_shared<std::packaged_task<Result()> >(f);
+                std::future<Result> result = task->get_future();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    tasks_.push_back([task]() { (*task)(); });
+                }
+                cv_.notify_one();
+                return result;
+            }
+
+        private:
+            io_thread_pool(const io_thread_pool&);
+            void operator=(const io_thread_pool&);
+
+            void run()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for(;;)
+                {
+                    while(tasks_.empty() && !stop_)
+                        cv_.wait(lock);
+                    // Finish all submitted tasks before stopping, somebody might wait for them
+                    if(tasks_.empty())
+                        return;
+                    const std::function<void()> task = tasks_.front();
+                    tasks_.pop_front();
+                    lock.unlock();
+                    task();
+                    lock.lock();
+                }
+            }
+
+            bool stop_;
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            std::deque<std::function<void()> > tasks_;
+            std::vector<std::thread> threads_;
+        };
+    } // namespace detail
+} // namespace nowide
+
+#endif
@@ -0,0 +1,127 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_DETAIL_LARGE_FILE_HPP_INCLUDED
+#define NOWIDE_DETAIL_LARGE_FILE_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#ifndef NOWIDE_WINDOWS
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace nowide {
+    namespace detail {
+        ///
+        /// File functions using 64 bit offsets independent of _FILE_OFFSET_BITS.
+        /// glibc uses a 32 bit off_t on 32 bit systems unless _FILE_OFFSET_BITS=64 is defined
+        /// by the user of the headers, so the explicit 64 bit variants are used there.
+        ///
+#if defined(__GLIBC__) && defined(_LARGEFILE64_SOURCE)
+        typedef off64_t large_off_t;
+        typedef struct stat64 large_stat_t;
+
+        inline int large_open(const char* path, int flags)
+        {
+            return ::open64(path, flags, 0666);
+        }
+        inline FILE* large_fopen(const char* path, const char* mode)
+        {
+            return ::fopen64(path, mode);
+        }
+        inline int large_fstat(int fd, large_stat_t* st)
+        {
+            return ::fstat64(fd, st);
+        }
+        inline large_off_t large_lseek(int fd, large_off_t off, int whence)
+        {
+            return ::lseek64(fd, off, whence);
+        }
+        inline int large_fseek(FILE* f, large_off_t off, int whence)
+        {
+            return ::fseeko64(f, off, whence);
+        }
+        inline large_off_t large_ftell(FILE* f)
+        {
+            return ::ftello64(f);
+        }
+        inline ssize_t large_pread(int fd, void* s, size_t n, large_off_t pos)
+        {
+            return ::pread64(fd, s, n, pos);
+        }
+        inline ssize_t large_pwrite(int fd, const void* s, size_t n, large_off_t pos)
+        {
+            return ::pwrite64(fd, s, n, pos);
+        }
+#ifdef __linux__
+        inline int large_fallocate(int fd, int mode, large_off_t offset, large_off_t length)
+        {
+            return ::fallocate64(fd, mode, offset, length);
+        }
+#endif
+#ifdef POSIX_FADV_NORMAL
+        inline int large_fadvise(int fd, large_off_t offset, large_off_t length, int advice)
+        {
+            return ::posix_fadvise64(fd, offset, length, advice);
+        }
+#endif
+#else
+        typedef off_t large_off_t;
+        typedef struct stat large_stat_t;
+
+        inline int large_open(const char* path, int flags)
+        {
+            return ::open(path, flags, 0666);
+        }
+        inline FILE* large_fopen(const char* path, const char* mode)
+        {
+            return std::fopen(path, mode);
+        }
+        inline int large_fstat(int fd, large_stat_t* st)
+        {
+            return ::fstat(fd, st);
+        }
+        inline large_off_t large_lseek(int fd, large_off_t off, int whence)
+        {
+            return ::lseek(fd, off, whence);
+        }
+        inline int large_fseek(FILE* f, large_off_t off, int whence)
+        {
+            return ::fseeko(f, off, whence);
+        }
+        inline large_off_t large_ftell(FILE* f)
+        {
+            return ::ftello(f);
+        }
+        inline ssize_t large_pread(int fd, void* s, size_t n, large_off_t pos)
+        {
+            return ::pread(fd, s, n, pos);
+        }
+        inline ssize_t large_pwrite(int fd, const void* s, size_t n, large_off_t pos)
+        {
+            return ::pwrite(fd, s, n, pos);
+        }
+#ifdef __linux__
+        inline int large_fallocate(int fd, int mode, large_off_t offset, large_off_t length)
+        {
+            return ::fallocate(fd, mode, offset, length);
+        }
+#endif
+#ifdef POSIX_FADV_NORMAL
+        inline int large_fadvise(int fd, large_off_t offset, large_off_t length, int advice)
+        {
+            return ::posix_fadvise(fd, offset, length, advice);
+        }
+#endif
+#endif
+    } // namespace detail
+} // namespace nowide
+#endif
+
+#endif
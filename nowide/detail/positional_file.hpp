@@ -0,0 +1,212 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_DETAIL_POSITIONAL_FILE_HPP_INCLUDED
+#define NOWIDE_DETAIL_POSITIONAL_FILE_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/detail/large_file.hpp>
+#include <nowide/stackstring.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <ios>
+#ifdef NOWIDE_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#include <mutex>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace nowide {
+    namespace detail {
+        ///
+        /// \brief Binary file accessed at explicit positions, so it can be used from multiple threads at once
+        ///
+        /// Uses pread/pwrite on POSIX. On Windows the accesses are serialized and use a seek followed by read/write
+        ///
+        class positional_file
+        {
+        public:
+            positional_file() : fd_(-1)
+            {}
+            ~positional_file()
+            {
+                close();
+            }
+
+            ///
+            /// Open the UTF-8 file name \a path for reading (in), writing (out, truncates unless app is set)
+            /// or both (in|out, creates the file if it does not exist).
+            /// With app all writes go to the end of the file, use append() then.
+            /// The file is always opened in binary mode
+            ///
+            bool open(const char* path, std::ios_base::openmode mode)
+            {
+                if(is_open())
+                    return false;
+                int flags;
+                const bool in = (mode & std::ios_base::in) != 0;
+                const bool out = (mode & (std::ios_base::out | std::ios_base::app)) != 0;
+                if(in && out)
+                    flags = O_RDWR | O_CREAT;
+                else if(out)
+                {
+                    flags = O_WRONLY | O_CREAT;
+                    if(!(mode & std::ios_base::app))
+                        flags |= O_TRUNC;
+                } else if(in)
+                    flags = O_RDONLY;
+                else
+                    return false;
+                if(mode & std::ios_base::trunc)
+                    flags |= O_TRUNC;
+                if(mode & std::ios_base::app)
+                    flags |= O_APPEND;
+#ifdef NOWIDE_WINDOWS
+                const wstackstring name(path);
+                fd_ = ::_wopen(name.get(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+                do
+                {
+                    fd_ = large_open(path, flags);
+                } while(fd_ < 0 && errno == EINTR);
+#endif
+                return fd_ >= 0;
+            }
+            bool close()
+            {
+                if(!is_open())
+                    return true;
+                const int fd = fd_;
+                fd_ = -1;
+#ifdef NOWIDE_WINDOWS
+                return ::_close(fd) == 0;
+#else
+                return ::close(fd) == 0;
+#endif
+            }
+            bool is_open() const
+            {
+                return fd_ >= 0;
+            }
+
+            ///
+            /// Read \a n bytes at \a pos, less only on EOF or error
+            ///
+            size_t read_at(char* s, size_t n, std::streamoff pos)
+            {
+#ifdef NOWIDE_WINDOWS
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(::_lseeki64(fd_, pos, SEEK_SET) < 0)
+                    return 0;
+#endif
+                size_t total = 0;
+                while(total < n)
+                {
+#ifdef NOWIDE_WINDOWS
+                    const int cur =
+                      ::_read(fd_, s + total, static_cast<unsigned>((std::min)(n - total, size_t(1) << 30)));
+#else
+                    const ssize_t cur = large_pread(fd_, s + total, n - total, static_cast<large_off_t>(pos + total));
+                    if(cur < 0 && errno == EINTR)
+                        continue;
+#endif
+                    if(cur <= 0)
+                        break;
+                    total += static_cast<size_t>(cur);
+                }
+                return total;
+            }
+            ///
+            /// Write \a n bytes at \a pos, less only on error. Not for files opened with app
+            ///
+            size_t write_at(const char* s, size_t n, std::streamoff pos)
+            {
+#ifdef NOWIDE_WINDOWS
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(::_lseeki64(fd_, pos, SEEK_SET) < 0)
+                    return 0;
+#endif
+                size_t total = 0;
+                while(total < n)
+                {
+#ifdef NOWIDE_WINDOWS
+                    const int cur =
+                      ::_write(fd_, s + total, static_cast<unsigned>((std::min)(n - total, size_t(1) << 30)));
+#else
+                    const ssize_t cur =
+                      large_pwrite(fd_, s + total, n - total, static_cast<large_off_t>(pos + total));
+                    if(cur < 0 && errno == EINTR)
+                        continue;
+#endif
+                    if(cur <= 0)
+                        break;
+                    total += static_cast<size_t>(cur);
+                }
+                return total;
+            }
+            ///
+            /// Write \a n bytes at the end of a file opened with app, less only on error
+            ///
+            size_t append(const char* s, size_t n)
+            {
+#ifdef NOWIDE_WINDOWS
+                std::lock_guard<std::mutex> lock(mutex_);
+#endif
+                size_t total = 0;
+                while(total < n)
+                {
+#ifdef NOWIDE_WINDOWS
+                    const int cur =
+                      ::_write(fd_, s + total, static_cast<unsigned>((std::min)(n - total, size_t(1) << 30)));
+#else
+                    const ssize_t cur = ::write(fd_, s + total, n - total);
+                    if(cur < 0 && errno == EINTR)
+                        continue;
+#endif
+                    if(cur <= 0)
+                        break;
+                    total += static_cast<size_t>(cur);
+                }
+                return total;
+            }
+            ///
+            /// Size of the file or -1 on error
+            ///
+            std::streamoff size() const
+            {
+#ifdef NOWIDE_WINDOWS
+                struct _stat64 st;
+                if(::_fstat64(fd_, &st) != 0)
+                    return -1;
+#else
+                large_stat_t st;
+                if(large_fstat(fd_, &st) != 0)
+                    return -1;
+#endif
+                return st.st_size;
+            }
+
+        private:
+            positional_file(const positional_file&);
+            void operator=(const positional_file&);
+
+            int fd_;
+#ifdef NOWIDE_WINDOWS
+            std::mutex mutex_;
+#endif
+        };
+    } // namespace detail
+} // namespace nowide
+
+#endif
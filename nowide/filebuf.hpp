@@ -12,16 +12,49 @@
 #include <nowide/config.hpp>
 #if NOWIDE_USE_FILEBUF_REPLACEMENT
 #include <nowide/cstdio.hpp>
+#include <nowide/detail/background_writer.hpp>
+#include <nowide/detail/large_file.hpp>
+#include <nowide/detail/utf.hpp>
+#include <nowide/replacement.hpp>
 #include <nowide/stackstring.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <ios>
-#include <limits>
 #include <locale>
+#include <new>
 #include <stdexcept>
 #include <streambuf>
+#if NOWIDE_USE_FD_FILEBUF
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifndef NOWIDE_WINDOWS
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+#if !NOWIDE_USE_FD_FILEBUF && (defined(__GLIBC__) || defined(__sun))
+#include <stdio_ext.h>
+#endif
+#if NOWIDE_USE_FD_FILEBUF && defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+#include <vector>
 #else
 #include <fstream>
+#include <vector>
 #endif
 
 
@@ -34,16 +67,101 @@ namespace nowide {
     /// \brief This forward declaration defines the basic_filebuf type.
     ///
     /// it is implemented and specialized for CharType = char, it
-    /// implements std::filebuf over standard C I/O
+    /// implements std::filebuf over standard C I/O.
+    /// For other character types the file content is converted from/to UTF-8
     ///
     template<typename CharType, typename Traits = std::char_traits<CharType> >
     class basic_filebuf;
 
+    ///
+    /// \brief Additional options for opening a basic_filebuf
+    ///
+    struct filebuf_options
+    {
+        ///
+        /// Size of the buffer in bytes. 0 (default) keeps the current size,
+        /// which is BUFSIZ or the size set by setbuf
+        ///
+        size_t buffer_size;
+        ///
+        /// If larger than the buffer size the buffer is doubled up to this size each time a full buffer
+        /// was read or written sequentially. So bulk copies use few large reads/writes while
+        /// small or randomly accessed files keep a small buffer.
+        /// A buffer set by setbuf is never grown
+        ///
+        size_t max_buffer_size;
+        ///
+        /// Disable the buffer of the underlying C stream so the buffer of the filebuf is the only one
+        /// and data is copied only once.
+        /// Ignored for an unbuffered filebuf as every character would then result in a system call.
+        /// Has no effect with #NOWIDE_USE_FD_FILEBUF, where the filebuf buffer is always the only one
+        ///
+        bool single_buffer;
+        ///
+        /// For files opened for reading only: Map the whole file into memory and use the mapping as the
+        /// get area. Reading then needs no system calls or copies to the buffer and seeks only move the read position.
+        /// Seeking beyond the end of the mapped file fails.
+        /// Pipes, special or empty files and failed mappings fall back to buffered reads.
+        /// Ignored on Windows
+        ///
+        bool memory_map;
+        ///
+        /// Hint that the file is read sequentially: The OS is advised to read ahead aggressively and each
+        /// refill of the buffer asks it to fetch the following buffer in the background,
+        /// so reads are served from the cache while the data is processed.
+        /// Ignored on systems without posix_fadvise, e.g. Windows
+        ///
+        bool sequential;
+        ///
+        /// For files opened for writing: A full buffer is written by a background thread while the next
+        /// one is filled, so writing data does not wait for the file system.
+        /// Errors of a background write are reported by the next write, sync or close.
+        /// Ignored for an unbuffered filebuf
+        ///
+        bool write_behind;
+        ///
+        /// Bypass the page cache of the OS (O_DIRECT), e.g. to stream huge files without evicting other data.
+        /// The buffer is rounded up to a multiple of 4 KiB and all reads and writes of full buffers are aligned.
+        /// Unaligned accesses, e.g. writing the tail of the file or a user-provided buffer,
+        /// switch back to cached I/O for the rest of the time the file is open, so they still work.
+        /// Only used with #NOWIDE_USE_FD_FILEBUF on systems with O_DIRECT, ignored for an unbuffered filebuf
+        ///
+        bool direct_io;
+        ///
+        /// For files opened for writing: Expected final size of the file in bytes, 0 (default) if unknown.
+        /// The disk space is reserved when opening without changing the size of the file,
+        /// which avoids fragmentation and updates of the file system metadata while writing.
+        /// Only used on Linux (fallocate with FALLOC_FL_KEEP_SIZE), a failure to reserve the space is ignored
+        ///
+        std::streamoff preallocate;
+        ///
+        /// The file is only used by one thread at a time, so the C stream does not need to lock itself
+        /// on each access. Makes especially an unbuffered filebuf faster.
+        /// Has no effect with #NOWIDE_USE_FD_FILEBUF, which never locks
+        ///
+        bool unlocked;
+        ///
+        /// Keep the buffer when the file is closed, so the next file opened by the filebuf reuses it
+        /// instead of allocating a new one. It is freed on destruction
+        ///
+        bool keep_buffer;
+
+        filebuf_options() :
+            buffer_size(0), max_buffer_size(0), single_buffer(false), memory_map(false), sequential(false),
+            write_behind(false), direct_io(false), preallocate(0), unlocked(false), keep_buffer(false)
+        {}
+    };
+
+    class batch_writer;
+    class line_reader;
+    inline std::streamsize copy_file_contents(basic_filebuf<char>& from, basic_filebuf<char>& to);
+
     ///
     /// \brief This is the implementation of std::filebuf
     ///
     /// it is implemented and specialized for CharType = char, it
-    /// implements std::filebuf over standard C I/O
+    /// implements std::filebuf over standard C I/O or over POSIX file descriptors
+    /// if #NOWIDE_USE_FD_FILEBUF is set
     ///
     template<>
     class basic_filebuf<char> : public std::basic_streambuf<char>
@@ -53,14 +171,30 @@ namespace nowide {
         basic_filebuf& operator=(const basic_filebuf<char>&);
 
         typedef std::char_traits<char> Traits;
+        friend class batch_writer;
+        friend class line_reader;
+        friend std::streamsize copy_file_contents(basic_filebuf<char>& from, basic_filebuf<char>& to);
+        // UTF-8 file names can be used directly on POSIX, only Windows needs wide ones
+#if NOWIDE_USE_FD_FILEBUF || !defined(NOWIDE_WINDOWS)
+        typedef char path_char;
+#else
+        typedef wchar_t path_char;
+#endif
 
     public:
         ///
         /// Creates new filebuf
         ///
         basic_filebuf() :
-            buffer_size_(BUFSIZ), buffer_(0), file_(0), owns_buffer_(false), last_char_(0),
-            mode_(std::ios_base::openmode(0))
+            buffer_size_(BUFSIZ), max_buffer_size_(0), buffer_(0),
+#if NOWIDE_USE_FD_FILEBUF
+            fd_(-1),
+#else
+            file_(0),
+#endif
+            map_(0), map_size_(0), writer_(0), behind_buffer_(0), behind_size_(0), file_pos_(-1), seek_pending_(false),
+            unflushed_(false), owns_buffer_(false), sequential_(false), direct_(false), unlocked_(false), keep_buffer_(false),
+            last_char_(0), mode_(std::ios_base::openmode(0))
         {
             setg(0, 0, 0);
             setp(0, 0);
@@ -69,45 +203,42 @@ namespace nowide {
         virtual ~basic_filebuf()
         {
             close();
+            if(owns_buffer_)
+                free_buffer(buffer_);
         }
 
         ///
         /// Same as std::filebuf::open but s is UTF-8 string
         ///
-        basic_filebuf* open(const std::string& s, std::ios_base::openmode mode)
+        basic_filebuf* open(const std::string& s,
+                            std::ios_base::openmode mode,
+                            const filebuf_options& options = filebuf_options())
         {
-            return open(s.c_str(), mode);
+            return open(s.c_str(), mode, options);
         }
         ///
         /// Same as std::filebuf::open but s is UTF-8 string
         ///
-        basic_filebuf* open(const char* s, std::ios_base::openmode mode)
+        basic_filebuf*
+        open(const char* s, std::ios_base::openmode mode, const filebuf_options& options = filebuf_options())
         {
+#if NOWIDE_USE_FD_FILEBUF || !defined(NOWIDE_WINDOWS)
+            return do_open(s, mode, options);
+#else
             const wstackstring name(s);
-            return open(name.get(), mode);
+            return do_open(name.get(), mode, options);
+#endif
         }
         /// Opens the file with the given name, see std::filebuf::open
-        basic_filebuf* open(const wchar_t* s, std::ios_base::openmode mode)
+        basic_filebuf*
+        open(const wchar_t* s, std::ios_base::openmode mode, const filebuf_options& options = filebuf_options())
         {
-            if(is_open())
-                return NULL;
-            validate_cvt(this->getloc());
-            const bool ate = (mode & std::ios_base::ate) != 0;
-            if(ate)
-                mode &= ~std::ios_base::ate;
-            const wchar_t* smode = get_mode(mode);
-            if(!smode)
-                return 0;
-            file_ = detail::wfopen(s, smode);
-            if(!file_)
-                return 0;
-            if(ate && std::fseek(file_, 0, SEEK_END) != 0)
-            {
-                close();
-                return 0;
-            }
-            mode_ = mode;
-            return this;
+#if NOWIDE_USE_FD_FILEBUF || !defined(NOWIDE_WINDOWS)
+            const stackstring name(s);
+            return do_open(name.get(), mode, options);
+#else
+            return do_open(s, mode, options);
+#endif
         }
         ///
         /// Same as std::filebuf::close()
@@ -117,37 +248,361 @@ namespace nowide {
             if(!is_open())
                 return NULL;
             bool res = sync() == 0;
-            if(std::fclose(file_) != 0)
+            unmap_file();
+            if(writer_)
+            {
+                delete writer_;
+                writer_ = NULL;
+                free_buffer(behind_buffer_);
+                behind_buffer_ = NULL;
+                behind_size_ = 0;
+            }
+            if(!close_file())
                 res = false;
-            file_ = NULL;
             mode_ = std::ios_base::openmode(0);
-            if(owns_buffer_)
+            sequential_ = false;
+            direct_ = false;
+            unlocked_ = false;
+            setg(0, 0, 0);
+            setp(0, 0);
+            if(owns_buffer_ && !keep_buffer_)
             {
-                delete[] buffer_;
+                free_buffer(buffer_);
                 buffer_ = NULL;
                 owns_buffer_ = false;
             }
             return res ? this : NULL;
         }
         ///
+        /// Deallocate the disk space of \a length bytes starting at \a offset, creating a sparse file.
+        /// The size of the file is not changed and reading the range returns zeros.
+        /// Pending output is written before. The file must be open for writing.
+        /// Returns false on error or if not supported by the system or file system (only available on Linux)
+        ///
+        bool punch_hole(std::streamoff offset, std::streamoff length)
+        {
+            if(!(mode_ & (std::ios_base::out | std::ios_base::app)) || offset < 0 || length <= 0)
+                return false;
+            if(sync() != 0)
+                return false;
+#ifdef __linux__
+            return detail::large_fallocate(native_fd(),
+                                           FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                                           static_cast<detail::large_off_t>(offset),
+                                           static_cast<detail::large_off_t>(length))
+                   == 0;
+#else
+            return false;
+#endif
+        }
+        ///
+        /// Make at least \a min_size bytes readable directly in the buffer, less only at the end of the file.
+        /// Returns a pointer to the next unread byte and stores the number of readable bytes in \a size,
+        /// or NULL if nothing can be read. Consume the bytes with commit_read().
+        /// The buffer is replaced by a larger one if it is smaller than \a min_size
+        ///
+        const char* acquire_read(size_t min_size, size_t& size)
+        {
+            size = 0;
+            if(!(mode_ & std::ios_base::in) || !stop_writing())
+                return NULL;
+            if(min_size == 0)
+                min_size = 1;
+            size_t available = gptr() ? egptr() - gptr() : 0;
+            if(available < min_size && !map_)
+            {
+                if(!buffer_ || buffer_size_ < min_size)
+                {
+                    const size_t new_size = aligned_buffer_size((std::max)(buffer_size_, min_size));
+                    char* const buffer = allocate_buffer(new_size);
+                    if(available)
+                        std::memcpy(buffer, gptr(), available);
+                    if(owns_buffer_)
+                        free_buffer(buffer_);
+                    buffer_ = buffer;
+                    buffer_size_ = new_size;
+                    owns_buffer_ = true;
+                } else if(available)
+                    std::memmove(buffer_, gptr(), available);
+                available += read_file(buffer_ + available, buffer_size_ - available);
+                if(available)
+                    setg(buffer_, buffer_, buffer_ + available);
+                else
+                    setg(0, 0, 0);
+            }
+            size = available;
+            return available ? gptr() : NULL;
+        }
+        ///
+        /// Consume \a n bytes returned by acquire_read()
+        ///
+        void commit_read(size_t n)
+        {
+            assert(n <= static_cast<size_t>(egptr() - gptr()));
+            if(n)
+                setg(eback(), gptr() + n, egptr());
+        }
+        ///
+        /// Make room for at least \a min_size bytes directly in the buffer, writing pending output if required.
+        /// Returns a pointer to the next byte to write and stores the number of writable bytes in \a size,
+        /// or NULL on error. Publish the written bytes with commit_write().
+        /// The buffer is replaced by a larger one if it is smaller than \a min_size
+        ///
+        char* acquire_write(size_t min_size, size_t& size)
+        {
+            size = 0;
+            if(!(mode_ & std::ios_base::out) || !stop_reading())
+                return NULL;
+            if(min_size == 0)
+                min_size = 1;
+            if(!pptr() || static_cast<size_t>(epptr() - pptr()) < min_size)
+            {
+                if(pptr() && pptr() > pbase() && overflow() == EOF)
+                    return NULL;
+                if(!buffer_ || buffer_size_ < min_size)
+                {
+                    setp(0, 0);
+                    if(owns_buffer_)
+                        free_buffer(buffer_);
+                    buffer_size_ = aligned_buffer_size((std::max)(buffer_size_, min_size));
+                    buffer_ = allocate_buffer(buffer_size_);
+                    owns_buffer_ = true;
+                }
+                setp(buffer_, buffer_ + buffer_size_);
+            }
+            size = epptr() - pptr();
+            return pptr();
+        }
+        ///
+        /// Publish \a n bytes written to the buffer returned by acquire_write()
+        ///
+        void commit_write(size_t n)
+        {
+            assert(n <= static_cast<size_t>(epptr() - pptr()));
+            if(n)
+                pbump(static_cast<int>(n));
+        }
+        ///
+        /// Read up to \a n bytes at position \a pos of the file into \a s, less only at the end of the file.
+        /// The position of the stream is not changed and data in its buffer is not taken into account.
+        /// May be called from multiple threads at once but not concurrently with other functions of the filebuf.
+        /// Returns the number of bytes read or -1 on error or if not supported (Windows)
+        ///
+        std::streamsize read_at(char* s, std::streamsize n, std::streamoff pos)
+        {
+            if(!(mode_ & std::ios_base::in) || n < 0 || pos < 0)
+                return -1;
+            if(map_)
+            {
+                if(pos >= static_cast<std::streamoff>(map_size_))
+                    return 0;
+                const std::streamsize available = static_cast<std::streamsize>(map_size_ - pos);
+                if(n > available)
+                    n = available;
+                std::memcpy(s, map_ + pos, static_cast<size_t>(n));
+                return n;
+            }
+#ifdef NOWIDE_WINDOWS
+            return -1;
+#else
+            const int fd = native_fd();
+            std::streamsize total = 0;
+            while(total < n)
+            {
+                const ssize_t cur = detail::large_pread(
+                  fd, s + total, static_cast<size_t>(n - total), static_cast<detail::large_off_t>(pos + total));
+                if(cur < 0 && errno == EINTR)
+                    continue;
+                if(cur < 0 && total == 0)
+                    return -1;
+                if(cur <= 0)
+                    break;
+                total += cur;
+            }
+            return total;
+#endif
+        }
+        ///
+        /// Write \a n bytes from \a s at position \a pos of the file, less only on error.
+        /// The position of the stream is not changed and data in its buffer is not taken into account,
+        /// so call pubsync() before if the written range might be buffered.
+        /// May be called from multiple threads at once but not concurrently with other functions of the filebuf.
+        /// Returns the number of bytes written or -1 on error, for files opened for appending
+        /// or if not supported (Windows)
+        ///
+        std::streamsize write_at(const char* s, std::streamsize n, std::streamoff pos)
+        {
+            if(!(mode_ & std::ios_base::out) || (mode_ & std::ios_base::app) || n < 0 || pos < 0)
+                return -1;
+#ifdef NOWIDE_WINDOWS
+            return -1;
+#else
+            const int fd = native_fd();
+            std::streamsize total = 0;
+            while(total < n)
+            {
+                const ssize_t cur = detail::large_pwrite(
+                  fd, s + total, static_cast<size_t>(n - total), static_cast<detail::large_off_t>(pos + total));
+                if(cur < 0 && errno == EINTR)
+                    continue;
+                if(cur < 0 && total == 0)
+                    return -1;
+                if(cur <= 0)
+                    break;
+                total += cur;
+            }
+            return total;
+#endif
+        }
+        ///
         /// Same as std::filebuf::is_open()
         ///
         bool is_open() const
         {
+#if NOWIDE_USE_FD_FILEBUF
+            return fd_ >= 0;
+#else
             return file_ != NULL;
+#endif
         }
 
     private:
+        basic_filebuf* do_open(const path_char* s, std::ios_base::openmode mode, const filebuf_options& options)
+        {
+            if(is_open())
+                return NULL;
+            validate_cvt(this->getloc());
+            if(options.buffer_size > 0 && (options.buffer_size != buffer_size_ || !owns_buffer_))
+            {
+                setbuf(NULL, 0);
+                buffer_size_ = options.buffer_size;
+            }
+            max_buffer_size_ = options.max_buffer_size;
+            keep_buffer_ = options.keep_buffer;
+#if NOWIDE_USE_FD_FILEBUF && defined(O_DIRECT)
+            direct_ = options.direct_io && buffer_size_ > 0;
+            if(direct_ && (owns_buffer_ || !buffer_))
+            {
+                const size_t size = aligned_buffer_size(buffer_size_);
+                if(size != buffer_size_)
+                {
+                    setbuf(NULL, 0);
+                    buffer_size_ = size;
+                }
+                max_buffer_size_ = max_buffer_size_ / direct_io_alignment * direct_io_alignment;
+            }
+#endif
+            const bool ate = (mode & std::ios_base::ate) != 0;
+            if(ate)
+                mode &= ~std::ios_base::ate;
+            if(!open_file(s, mode))
+                return 0;
+#if !NOWIDE_USE_FD_FILEBUF
+            // Must be done before any other operation on the stream
+            if(options.single_buffer && buffer_size_ > 0 && std::setvbuf(file_, NULL, _IONBF, 0) != 0)
+            {
+                close_file();
+                return 0;
+            }
+            unlocked_ = options.unlocked;
+#if defined(__GLIBC__) || defined(__sun)
+            if(unlocked_)
+                ::__fsetlocking(file_, FSETLOCKING_BYCALLER);
+#endif
+#endif
+            mode_ = mode;
+            file_pos_ = can_track_pos() ? 0 : -1;
+            seek_pending_ = false;
+            unflushed_ = false;
+            sequential_ = options.sequential && (mode & std::ios_base::in);
+            if(sequential_)
+                advise_sequential();
+#ifdef __linux__
+            if(options.preallocate > 0 && (mode & (std::ios_base::out | std::ios_base::app)))
+                detail::large_fallocate(
+                  native_fd(), FALLOC_FL_KEEP_SIZE, 0, static_cast<detail::large_off_t>(options.preallocate));
+#endif
+            if(options.memory_map && !(mode & (std::ios_base::out | std::ios_base::app)) && map_file())
+            {
+                if(ate)
+                    setg(map_, map_ + map_size_, map_ + map_size_);
+            } else if(ate && seek_file(0, SEEK_END) < 0)
+            {
+                close_file();
+                mode_ = std::ios_base::openmode(0);
+                return 0;
+            } else if(mode & std::ios_base::app)
+            {
+                // Writes go to the end, so start there to report the right position.
+                // The position stays unknown if the file is not seekable, e.g. a pipe
+                seek_file(0, SEEK_END);
+            }
+            if(options.write_behind && (mode & (std::ios_base::out | std::ios_base::app)) && buffer_size_ > 0)
+                writer_ = new detail::background_writer(&basic_filebuf::write_behind_raw, this);
+            return this;
+        }
         void make_buffer()
         {
             if(buffer_)
                 return;
             if(buffer_size_ > 0)
             {
-                buffer_ = new char[buffer_size_];
+                buffer_ = allocate_buffer(buffer_size_);
                 owns_buffer_ = true;
             }
         }
+        /// Grow the buffer for sequential access, see filebuf_options::max_buffer_size
+        /// The get and put areas must be reset afterwards
+        void grow_buffer()
+        {
+            if(!owns_buffer_ || buffer_size_ >= max_buffer_size_)
+                return;
+            free_buffer(buffer_);
+            buffer_size_ = (std::min)(buffer_size_ * 2, max_buffer_size_);
+            buffer_ = allocate_buffer(buffer_size_);
+        }
+#if NOWIDE_USE_FD_FILEBUF
+        /// Alignment of buffers, file positions and sizes for direct I/O
+        static const size_t direct_io_alignment = 4096;
+        /// Buffers are always aligned so they can be used for direct I/O
+        static char* allocate_buffer(size_t n)
+        {
+            void* result;
+            if(::posix_memalign(&result, direct_io_alignment, n) != 0)
+                throw std::bad_alloc();
+            return static_cast<char*>(result);
+        }
+        static void free_buffer(char* buffer)
+        {
+            std::free(buffer);
+        }
+#else
+        static const size_t direct_io_alignment = 1;
+        static char* allocate_buffer(size_t n)
+        {
+            return new char[n];
+        }
+        static void free_buffer(char* buffer)
+        {
+            delete[] buffer;
+        }
+#endif
+        /// Number of characters kept in front of the get area when it is refilled, so they can be put back
+        static const size_t putback_size = 8;
+        /// Number of the last \a n characters read to keep for putting them back
+        size_t putback_keep(size_t n) const
+        {
+            // The putback area may use at most half of the buffer. Direct I/O reads to the start of the buffer
+            if(direct_ || n == 0)
+                return 0;
+            const size_t max_keep = buffer_size_ / 2 < putback_size ? buffer_size_ / 2 : putback_size;
+            return n < max_keep ? n : max_keep;
+        }
+        /// Size of a buffer holding at least n bytes which is usable for direct I/O if enabled
+        size_t aligned_buffer_size(size_t n) const
+        {
+            return direct_ ? (n + direct_io_alignment - 1) / direct_io_alignment * direct_io_alignment : n;
+        }
         void validate_cvt(const std::locale& loc)
         {
             if(!std::use_facet<std::codecvt<char, char, std::mbstate_t> >(loc).always_noconv())
@@ -158,12 +613,16 @@ namespace nowide {
         virtual std::streambuf* setbuf(char* s, std::streamsize n)
         {
             assert(n >= 0);
+            // The mapping is the buffer
+            if(map_)
+                return NULL;
             // Maximum compatibility: Discard all local buffers and use user-provided values
             // Users should call sync() before or better use it before any IO is done or any file is opened
             setg(NULL, NULL, NULL);
             setp(NULL, NULL);
             if(owns_buffer_)
-                delete[] buffer_;
+                free_buffer(buffer_);
+            owns_buffer_ = false;
             buffer_ = s;
             buffer_size_ = (n >= 0) ? static_cast<size_t>(n) : 0;
             return this;
@@ -180,8 +639,15 @@ namespace nowide {
             size_t n = pptr() - pbase();
             if(n > 0)
             {
-                if(std::fwrite(pbase(), 1, n, file_) != n)
+                const bool full = pptr() == epptr() && pbase() == buffer_;
+                if(writer_ && owns_buffer_ && pbase() == buffer_)
+                {
+                    if(!write_behind(n))
+                        return EOF;
+                } else if(write_file(pbase(), n) != n)
                     return -1;
+                if(full)
+                    grow_buffer();
                 setp(buffer_, buffer_ + buffer_size_);
                 if(c != EOF)
                 {
@@ -196,31 +662,102 @@ namespace nowide {
                     setp(buffer_, buffer_ + buffer_size_);
                     *buffer_ = Traits::to_char_type(c);
                     pbump(1);
-                } else if(std::fputc(c, file_) == EOF)
-                {
-                    return EOF;
-                } else if(!pptr())
+                } else
                 {
+                    last_char_ = Traits::to_char_type(c);
+                    if(write_file(&last_char_, 1) != 1)
+                        return EOF;
                     // Set to dummy value so we know we have written something
-                    setp(&last_char_, &last_char_);
+                    if(!pptr())
+                        setp(&last_char_, &last_char_);
                 }
             }
             return Traits::not_eof(c);
         }
 
+        virtual std::streamsize xsputn(const char* s, std::streamsize n)
+        {
+            if(!(mode_ & std::ios_base::out))
+                return 0;
+            if(pptr() && epptr() - pptr() >= n)
+            {
+                std::memcpy(pptr(), s, static_cast<size_t>(n));
+                pbump(static_cast<int>(n));
+                return n;
+            }
+            // With direct I/O only the aligned buffer is used
+            if(n < static_cast<std::streamsize>(buffer_size_) || direct_)
+                return std::basic_streambuf<char>::xsputn(s, n);
+            // Large block: Write pending data and then the block directly without copying it to the buffer
+            if(!stop_reading())
+                return 0;
+            if(pptr())
+            {
+                const size_t pending = pptr() - pbase();
+                if(pending && write_file(pbase(), pending) != pending)
+                    return 0;
+                setp(pbase(), epptr());
+            } else
+            {
+                // Set to dummy value so we know we have written something
+                setp(&last_char_, &last_char_);
+            }
+            return write_file(s, static_cast<size_t>(n));
+        }
+
+        virtual std::streamsize xsgetn(char* s, std::streamsize n)
+        {
+            if(!(mode_ & std::ios_base::in))
+                return 0;
+            std::streamsize copied = 0;
+            if(gptr() < egptr())
+            {
+                copied = (std::min)(n, static_cast<std::streamsize>(egptr() - gptr()));
+                std::memcpy(s, gptr(), static_cast<size_t>(copied));
+                // A mapped file can exceed the range of gbump
+                setg(eback(), gptr() + copied, egptr());
+                if(copied == n)
+                    return n;
+            }
+            // Everything left was in the mapping
+            if(map_)
+                return copied;
+            if(n - copied < static_cast<std::streamsize>(buffer_size_) || direct_)
+                return copied + std::basic_streambuf<char>::xsgetn(s + copied, n - copied);
+            // Large block: The buffer is empty now so read the rest directly into the target
+            if(!stop_writing())
+                return copied;
+            // File position is at the end of the buffer, discard it so it won't be used by pbackfail
+            setg(0, 0, 0);
+            const size_t n_read = read_file(s + copied, static_cast<size_t>(n - copied));
+            if(sequential_ && n_read > 0)
+                prefetch(n_read);
+            // Instead the end of the block can be put back
+            const size_t keep = putback_keep(n_read);
+            if(keep)
+            {
+                make_buffer();
+                std::memcpy(buffer_, s + copied + n_read - keep, keep);
+                setg(buffer_, buffer_ + keep, buffer_ + keep);
+            }
+            return copied + n_read;
+        }
+
         virtual int sync()
         {
-            if(!file_)
+            if(!is_open())
                 return 0;
             bool result;
             if(pptr())
             {
                 result = overflow() != EOF;
-                // Only flush if anything was written, otherwise behavior of fflush is undefined
-                if(std::fflush(file_) != 0)
-                    return result = false;
+                if(!finish_write_behind())
+                    result = false;
             } else
                 result = stop_reading();
+            // The put area might have been written already, e.g. by a seek
+            if(!flush_written())
+                result = false;
             return result ? 0 : -1;
         }
 
@@ -230,20 +767,44 @@ namespace nowide {
                 return EOF;
             if(!stop_writing())
                 return EOF;
+            // The whole file is in the get area
+            if(map_)
+                return EOF;
             if(buffer_size_ == 0)
             {
-                const int c = std::fgetc(file_);
-                if(c == EOF)
+                if(read_file(&last_char_, 1) != 1)
                     return EOF;
-                last_char_ = Traits::to_char_type(c);
                 setg(&last_char_, &last_char_, &last_char_ + 1);
             } else
             {
+                // Keep the end of the get area in front of the new one so it can be put back
+                char putback[putback_size];
+                const size_t keep = gptr() ? putback_keep(egptr() - eback()) : 0;
+                if(keep)
+                    std::memcpy(putback, egptr() - keep, keep);
+                if(gptr() == egptr() && eback() == buffer_ && egptr() == buffer_ + buffer_size_)
+                    grow_buffer();
                 make_buffer();
-                const size_t n = std::fread(buffer_, 1, buffer_size_, file_);
-                setg(buffer_, buffer_, buffer_ + n);
-                if(n == 0)
+                if(keep)
+                    std::memcpy(buffer_, putback, keep);
+                // Direct I/O: Start reading at the previous aligned position
+                const size_t skip = direct_ ? static_cast<size_t>(file_pos_ % direct_io_alignment) : 0;
+                if(skip && seek_file(file_pos_ - skip, SEEK_SET) < 0)
                     return EOF;
+                const size_t n = read_file(buffer_ + keep, buffer_size_ - keep);
+                if(n <= skip)
+                {
+                    if(skip)
+                        seek_file(file_pos_ - n + skip, SEEK_SET);
+                    if(keep)
+                        setg(buffer_, buffer_ + keep, buffer_ + keep);
+                    else
+                        setg(0, 0, 0);
+                    return EOF;
+                }
+                setg(buffer_, buffer_ + keep + skip, buffer_ + keep + n);
+                if(sequential_)
+                    prefetch(buffer_size_);
             }
             return Traits::to_int_type(*gptr());
         }
@@ -277,14 +838,42 @@ namespace nowide {
                                        std::ios_base::seekdir seekdir,
                                        std::ios_base::openmode = std::ios_base::in | std::ios_base::out)
         {
-            if(!file_)
+            if(!is_open())
                 return EOF;
-            // Switching between input<->output requires a seek
-            // So do NOT optimize for seekoff(0, cur) as No-OP
+            if(map_)
+                return seek_mapped(off, seekdir);
+            // Seeks within the get area only move the read position and tell is done without a system call.
+            // Switching between input<->output is still fine as stop_reading sets the file position
+            if(file_pos_ >= 0 && seekdir != std::ios_base::end)
+            {
+                if(gptr())
+                {
+                    // The file position is at the end of the get area
+                    const std::streamoff begin_pos = file_pos_ - (egptr() - eback());
+                    const std::streamoff pos =
+                      (seekdir == std::ios_base::cur) ? file_pos_ - (egptr() - gptr()) + off : off;
+                    if(begin_pos <= pos && pos <= file_pos_)
+                    {
+                        setg(eback(), eback() + (pos - begin_pos), egptr());
+                        return pos;
+                    }
+                } else if(pptr() && seekdir == std::ios_base::cur && off == 0)
+                    return file_pos_ + (pptr() - pbase());
+            }
 
-            // On some implementations a seek also flushes, so do a full sync
-            if(sync() != 0)
+            // Write pending output and only remember the new position, the file pointer is moved by the next read
+            // or write. This deferred seek also serves as the flush C streams require between writing and reading
+            if(!stop_reading() || (pptr() && !write_put_area()))
                 return EOF;
+            if(file_pos_ >= 0 && seekdir != std::ios_base::end)
+            {
+                const std::streamoff pos = (seekdir == std::ios_base::cur) ? file_pos_ + off : off;
+                if(pos < 0)
+                    return EOF;
+                file_pos_ = pos;
+                seek_pending_ = true;
+                return pos;
+            }
             int whence;
             switch(seekdir)
             {
@@ -293,10 +882,7 @@ namespace nowide {
             case std::ios_base::end: whence = SEEK_END; break;
             default: assert(false); return EOF;
             }
-            assert(off <= std::numeric_limits<long>::max());
-            if(std::fseek(file_, static_cast<long>(off), whence) != 0)
-                return EOF;
-            return std::ftell(file_);
+            return seek_file(off, whence);
         }
         virtual std::streampos seekpos(std::streampos pos,
                                        std::ios_base::openmode m = std::ios_base::in | std::ios_base::out)
@@ -311,15 +897,18 @@ namespace nowide {
 
     private:
         /// Stop reading adjusting the file pointer if necessary
-        /// Postcondition: gptr() == NULL
+        /// Postcondition: gptr() == NULL unless the file is mapped, which is only possible in read-only mode
         bool stop_reading()
         {
-            if(gptr())
+            if(gptr() && !map_)
             {
                 const std::streamsize off = gptr() - egptr();
                 setg(0, 0, 0);
-                assert(off <= std::numeric_limits<long>::max());
-                if(off && std::fseek(file_, static_cast<long>(off), SEEK_CUR) != 0)
+                if(off && file_pos_ >= 0)
+                {
+                    file_pos_ += off;
+                    seek_pending_ = true;
+                } else if(off && seek_file(off, SEEK_CUR) < 0)
                     return false;
             }
             return true;
@@ -331,77 +920,632 @@ namespace nowide {
         {
             if(pptr())
             {
-                const char* const base = pbase();
-                const size_t n = pptr() - base;
-                setp(0, 0);
-                if(n && std::fwrite(base, 1, n, file_) != n)
+                if(!write_put_area())
                     return false;
+                // C streams require a flush between writing and reading
+                return flush_written();
             }
             return true;
         }
-
-        void reset(FILE* f = 0)
+        /// Write the put area to the file, also waiting for a background write
+        /// Postcondition: pptr() == NULL
+        bool write_put_area()
+        {
+            const char* const base = pbase();
+            const size_t n = pptr() - base;
+            setp(0, 0);
+            if(n && write_file(base, n) != n)
+                return false;
+            return finish_write_behind();
+        }
+        /// Flush the file if anything was written since the last flush,
+        /// otherwise the behavior of fflush is undefined
+        bool flush_written()
+        {
+            if(!unflushed_)
+                return true;
+            unflushed_ = false;
+            return flush_file();
+        }
+        /// Implementation of copy_file_contents
+        std::streamsize copy_to(basic_filebuf& to)
+        {
+            if(!(mode_ & std::ios_base::in) || !(to.mode_ & (std::ios_base::out | std::ios_base::app)) || &to == this)
+                return -1;
+            if(!stop_writing() || to.sync() != 0)
+                return -1;
+            std::streamsize total = 0;
+            // Data already in the buffer (or the mapping) first
+            if(gptr() < egptr())
+            {
+                const size_t n = egptr() - gptr();
+                if(!to.stop_reading() || to.write_file(gptr(), n) != n)
+                    return -1;
+                setg(eback(), egptr(), egptr());
+                total += n;
+            }
+            if(map_)
+                return total;
+            setg(0, 0, 0);
+            if(!to.stop_reading())
+                return -1;
+#if NOWIDE_USE_FD_FILEBUF && defined(__linux__)
+            // Let the kernel copy the data without passing it through user space
+            if(!apply_seek() || !to.apply_seek() || !to.finish_write_behind())
+                return -1;
+            const size_t chunk = size_t(1) << 30;
+            bool use_copy_file_range = true;
+            bool copied = false;
+            for(;;)
+            {
+                ssize_t n = -1;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 27)
+                if(use_copy_file_range)
+                {
+                    n = ::copy_file_range(fd_, NULL, to.fd_, NULL, chunk, 0);
+                    // E.g. not supported by the file system or for this combination of files
+                    if(n < 0 && errno != EINTR && errno != EIO && errno != ENOSPC)
+                    {
+                        use_copy_file_range = false;
+                        continue;
+                    }
+                } else
+#endif
+                {
+                    n = ::sendfile(to.fd_, fd_, NULL, chunk);
+                }
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n <= 0)
+                {
+                    if(n == 0)
+                        return total;
+                    if(errno == EIO || errno == ENOSPC || copied)
+                        return -1;
+                    // Not possible, e.g. O_APPEND: Copy in user space
+                    break;
+                }
+                copied = true;
+                total += n;
+                if(file_pos_ >= 0)
+                    file_pos_ += n;
+                if(to.mode_ & std::ios_base::app)
+                    to.file_pos_ = -1;
+                else if(to.file_pos_ >= 0)
+                    to.file_pos_ += n;
+            }
+#endif
+            std::vector<char> buffer((std::max)(buffer_size_, size_t(64 * 1024)));
+            for(;;)
+            {
+                const size_t n = read_file(&buffer[0], buffer.size());
+                if(n == 0)
+                    return total;
+                if(to.write_file(&buffer[0], n) != n)
+                    return -1;
+                total += n;
+            }
+        }
+        /// Write the put area followed by \a n bytes from \a s, in one system call if possible
+        bool write_gathered(const char* s, size_t n)
         {
-            sync();
-            if(file_)
+            if(!(mode_ & std::ios_base::out))
+                return false;
+            if(!stop_reading())
+                return false;
+            const char* const base = pbase();
+            const size_t pending = pptr() ? pptr() - base : 0;
+            if(pptr())
+                setp(pbase(), epptr());
+            else
             {
-                fclose(file_);
-                file_ = 0;
+                // Set to dummy value so we know we have written something
+                setp(&last_char_, &last_char_);
             }
-            file_ = f;
+            return write_file(base, pending, s, n) == pending + n;
         }
 
-        static const wchar_t* get_mode(std::ios_base::openmode mode)
+        /// Move the read position of a mapped file
+        std::streamoff seek_mapped(std::streamoff off, std::ios_base::seekdir seekdir)
         {
-            //
-            // done according to n2914 table 106 27.9.1.4
-            //
-
-            // note can't use switch case as overload operator can't be used
-            // in constant expression
-            if(mode == (std::ios_base::out))
-                return L"w";
-            if(mode == (std::ios_base::out | std::ios_base::app))
-                return L"a";
-            if(mode == (std::ios_base::app))
-                return L"a";
-            if(mode == (std::ios_base::out | std::ios_base::trunc))
-                return L"w";
-            if(mode == (std::ios_base::in))
-                return L"r";
-            if(mode == (std::ios_base::in | std::ios_base::out))
-                return L"r+";
-            if(mode == (std::ios_base::in | std::ios_base::out | std::ios_base::trunc))
-                return L"w+";
-            if(mode == (std::ios_base::in | std::ios_base::out | std::ios_base::app))
-                return L"a+";
-            if(mode == (std::ios_base::in | std::ios_base::app))
-                return L"a+";
-            if(mode == (std::ios_base::binary | std::ios_base::out))
-                return L"wb";
-            if(mode == (std::ios_base::binary | std::ios_base::out | std::ios_base::app))
-                return L"ab";
-            if(mode == (std::ios_base::binary | std::ios_base::app))
-                return L"ab";
-            if(mode == (std::ios_base::binary | std::ios_base::out | std::ios_base::trunc))
-                return L"wb";
-            if(mode == (std::ios_base::binary | std::ios_base::in))
-                return L"rb";
-            if(mode == (std::ios_base::binary | std::ios_base::in | std::ios_base::out))
-                return L"r+b";
-            if(mode == (std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::trunc))
-                return L"w+b";
-            if(mode == (std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app))
-                return L"a+b";
-            if(mode == (std::ios_base::binary | std::ios_base::in | std::ios_base::app))
-                return L"a+b";
-            return 0;
+            std::streamoff pos;
+            switch(seekdir)
+            {
+            case std::ios_base::beg: pos = off; break;
+            case std::ios_base::cur: pos = (gptr() - map_) + off; break;
+            case std::ios_base::end: pos = static_cast<std::streamoff>(map_size_) + off; break;
+            default: assert(false); return EOF;
+            }
+            if(pos < 0 || pos > static_cast<std::streamoff>(map_size_))
+                return EOF;
+            setg(map_, map_ + pos, map_ + map_size_);
+            return pos;
         }
 
-        size_t buffer_size_;
-        char* buffer_;
+#ifdef NOWIDE_WINDOWS
+        bool map_file()
+        {
+            return false;
+        }
+        void unmap_file()
+        {}
+        void advise_sequential()
+        {}
+        void prefetch(size_t)
+        {}
+#else
+        int native_fd() const
+        {
+#if NOWIDE_USE_FD_FILEBUF
+            return fd_;
+#else
+            return ::fileno(file_);
+#endif
+        }
+        /// Map the whole file and use it as the get area, see filebuf_options::memory_map
+        bool map_file()
+        {
+            const int fd = native_fd();
+            detail::large_stat_t st;
+            if(detail::large_fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+                return false;
+            const size_t size = static_cast<size_t>(st.st_size);
+            if(static_cast<detail::large_off_t>(size) != st.st_size)
+                return false;
+            // Private and writable, so pbackfail can replace characters
+            void* const map = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if(map == MAP_FAILED)
+                return false;
+            map_ = static_cast<char*>(map);
+            map_size_ = size;
+            setg(map_, map_, map_ + map_size_);
+            return true;
+        }
+        void unmap_file()
+        {
+            if(map_)
+            {
+                ::munmap(map_, map_size_);
+                map_ = NULL;
+                map_size_ = 0;
+                setg(0, 0, 0);
+            }
+        }
+        /// See filebuf_options::sequential
+        void advise_sequential()
+        {
+#ifdef POSIX_FADV_SEQUENTIAL
+            detail::large_fadvise(native_fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        }
+        /// Start reading the next \a n bytes after the current file position in the background
+        void prefetch(size_t n)
+        {
+#ifdef POSIX_FADV_WILLNEED
+            if(file_pos_ >= 0)
+                detail::large_fadvise(native_fd(),
+                                      static_cast<detail::large_off_t>(file_pos_),
+                                      static_cast<detail::large_off_t>(n),
+                                      POSIX_FADV_WILLNEED);
+#else
+            (void)n;
+#endif
+        }
+#endif
+
+        // Low level file access functions
+        // The position of the file is tracked so it is known without a system call
+
+        /// False if positions don't correspond to the number of bytes read/written (Windows text mode)
+        bool can_track_pos() const
+        {
+#ifdef NOWIDE_WINDOWS
+            return (mode_ & std::ios_base::binary) != 0;
+#else
+            return true;
+#endif
+        }
+        /// Move the file pointer to the logical position after a deferred seek
+        bool apply_seek()
+        {
+            if(!seek_pending_)
+                return true;
+            if(!finish_write_behind())
+                return false;
+            seek_pending_ = false;
+            return seek_raw(file_pos_, SEEK_SET) == file_pos_;
+        }
+        size_t read_file(char* s, size_t n)
+        {
+            if(!finish_write_behind() || !apply_seek())
+                return 0;
+            const size_t result = read_raw(s, n);
+            if(file_pos_ >= 0)
+                file_pos_ += result;
+            return result;
+        }
+        size_t write_file(const char* s, size_t n)
+        {
+            if(!finish_write_behind() || !apply_seek())
+                return 0;
+            const size_t result = write_raw(s, n);
+            unflushed_ = true;
+            // Appending always writes to the end
+            if(mode_ & std::ios_base::app)
+                file_pos_ = -1;
+            else if(file_pos_ >= 0)
+                file_pos_ += result;
+            return result;
+        }
+        size_t write_file(const char* s1, size_t n1, const char* s2, size_t n2)
+        {
+            if(!finish_write_behind() || !apply_seek())
+                return 0;
+            const size_t result = write_raw(s1, n1, s2, n2);
+            unflushed_ = true;
+            if(mode_ & std::ios_base::app)
+                file_pos_ = -1;
+            else if(file_pos_ >= 0)
+                file_pos_ += result;
+            return result;
+        }
+        std::streamoff seek_file(std::streamoff off, int whence)
+        {
+            if(!finish_write_behind())
+                return -1;
+            if(seek_pending_ && whence == SEEK_CUR)
+            {
+                off += file_pos_;
+                whence = SEEK_SET;
+            }
+            seek_pending_ = false;
+            const std::streamoff result = seek_raw(off, whence);
+            file_pos_ = can_track_pos() ? result : -1;
+            return result;
+        }
+
+        /// Hand the first \a n bytes of the buffer to the background writer and continue with the second buffer
+        bool write_behind(size_t n)
+        {
+            // Unaligned direct writes switch to cached I/O, keep that in this thread
+            if(direct_ && (file_pos_ % direct_io_alignment || n % direct_io_alignment))
+                return write_file(buffer_, n) == n;
+            if(!writer_->wait() || !apply_seek())
+                return false;
+            std::swap(buffer_, behind_buffer_);
+            const size_t size = behind_size_;
+            behind_size_ = buffer_size_;
+            writer_->start(behind_buffer_, n);
+            unflushed_ = true;
+            if(mode_ & std::ios_base::app)
+                file_pos_ = -1;
+            else if(file_pos_ >= 0)
+                file_pos_ += n;
+            if(size < buffer_size_)
+            {
+                free_buffer(buffer_);
+                buffer_ = allocate_buffer(buffer_size_);
+            }
+            return true;
+        }
+        /// Wait for the background write to finish, false if it failed
+        bool finish_write_behind()
+        {
+            return !writer_ || writer_->wait();
+        }
+        static size_t write_behind_raw(void* self, const char* s, size_t n)
+        {
+            return static_cast<basic_filebuf*>(self)->write_raw(s, n);
+        }
+
+#if NOWIDE_USE_FD_FILEBUF
+        bool open_file(const char* s, std::ios_base::openmode mode)
+        {
+            const char* const smode = get_narrow_mode(mode);
+            if(!smode)
+                return false;
+            int flags;
+            const bool update = smode[1] == '+' || (smode[1] && smode[2] == '+');
+            switch(smode[0])
+            {
+            case 'r': flags = update ? O_RDWR : O_RDONLY; break;
+            case 'w': flags = (update ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC; break;
+            case 'a': flags = (update ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND; break;
+            default: assert(false); return false;
+            }
+#ifdef O_DIRECT
+            if(direct_)
+            {
+                do
+                {
+                    fd_ = detail::large_open(s, flags | O_DIRECT);
+                } while(fd_ < 0 && errno == EINTR);
+                // Not supported by the file system
+                if(fd_ >= 0 || errno != EINVAL)
+                    return fd_ >= 0;
+                direct_ = false;
+            }
+#endif
+            do
+            {
+                fd_ = detail::large_open(s, flags);
+            } while(fd_ < 0 && errno == EINTR);
+            return fd_ >= 0;
+        }
+        /// Continue with cached I/O after an unaligned access failed, true if that was possible
+        bool stop_direct_io()
+        {
+#ifdef O_DIRECT
+            if(!direct_ || errno != EINVAL)
+                return false;
+            const int flags = ::fcntl(fd_, F_GETFL);
+            if(flags < 0 || ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != 0)
+                return false;
+            direct_ = false;
+            return true;
+#else
+            return false;
+#endif
+        }
+        bool close_file()
+        {
+            const int fd = fd_;
+            fd_ = -1;
+            return ::close(fd) == 0;
+        }
+        /// Read n bytes, less only on EOF or error
+        size_t read_raw(char* s, size_t n)
+        {
+            size_t total = 0;
+            while(total < n)
+            {
+                const ssize_t cur = ::read(fd_, s + total, n - total);
+                if(cur < 0 && (errno == EINTR || stop_direct_io()))
+                    continue;
+                if(cur <= 0)
+                    break;
+                total += static_cast<size_t>(cur);
+                // A short direct read is at the end of the file, the next read would be unaligned
+                if(direct_ && static_cast<size_t>(cur) % direct_io_alignment)
+                    break;
+            }
+            return total;
+        }
+        /// Write n bytes, less only on error
+        size_t write_raw(const char* s, size_t n)
+        {
+            size_t total = 0;
+            while(total < n)
+            {
+                const ssize_t cur = ::write(fd_, s + total, n - total);
+                if(cur < 0 && (errno == EINTR || stop_direct_io()))
+                    continue;
+                if(cur <= 0)
+                    break;
+                total += static_cast<size_t>(cur);
+            }
+            return total;
+        }
+        /// Write n1 bytes from s1 followed by n2 bytes from s2, less only on error
+        size_t write_raw(const char* s1, size_t n1, const char* s2, size_t n2)
+        {
+            struct iovec iov[2];
+            iov[0].iov_base = const_cast<char*>(s1);
+            iov[0].iov_len = n1;
+            iov[1].iov_base = const_cast<char*>(s2);
+            iov[1].iov_len = n2;
+            struct iovec* cur = iov;
+            int count = 2;
+            size_t total = 0;
+            size_t written = 0;
+            for(;;)
+            {
+                // Skip what was written
+                while(count > 0 && written >= cur->iov_len)
+                {
+                    written -= cur->iov_len;
+                    ++cur;
+                    --count;
+                }
+                if(count == 0)
+                    break;
+                cur->iov_base = static_cast<char*>(cur->iov_base) + written;
+                cur->iov_len -= written;
+                const ssize_t result = ::writev(fd_, cur, count);
+                if(result < 0 && (errno == EINTR || stop_direct_io()))
+                {
+                    written = 0;
+                    continue;
+                }
+                if(result <= 0)
+                    break;
+                written = static_cast<size_t>(result);
+                total += written;
+            }
+            return total;
+        }
+        bool flush_file()
+        {
+            return true;
+        }
+        /// Set the file position and return it, -1 on error
+        std::streamoff seek_raw(std::streamoff off, int whence)
+        {
+            if(static_cast<detail::large_off_t>(off) != off)
+                return -1;
+            return detail::large_lseek(fd_, static_cast<detail::large_off_t>(off), whence);
+        }
+#else
+#ifdef NOWIDE_WINDOWS
+        bool open_file(const wchar_t* s, std::ios_base::openmode mode)
+        {
+            const wchar_t* const smode = get_mode(mode);
+            if(!smode)
+                return false;
+            file_ = detail::wfopen(s, smode);
+            return file_ != NULL;
+        }
+#else
+        bool open_file(const char* s, std::ios_base::openmode mode)
+        {
+            const char* const smode = get_narrow_mode(mode);
+            if(!smode)
+                return false;
+            file_ = detail::large_fopen(s, smode);
+            return file_ != NULL;
+        }
+#endif
+        bool close_file()
+        {
+            FILE* const f = file_;
+            file_ = NULL;
+            return std::fclose(f) == 0;
+        }
+        /// Read n bytes, less only on EOF or error
+        size_t read_raw(char* s, size_t n)
+        {
+            if(unlocked_)
+            {
+#ifdef NOWIDE_MSVC
+                return ::_fread_nolock(s, 1, n, file_);
+#elif !defined(NOWIDE_WINDOWS)
+                // Single characters of an unbuffered filebuf
+                if(n == 1)
+                {
+                    const int c = getc_unlocked(file_);
+                    if(c == EOF)
+                        return 0;
+                    *s = Traits::to_char_type(c);
+                    return 1;
+                }
+#endif
+            }
+            return std::fread(s, 1, n, file_);
+        }
+        /// Write n bytes, less only on error
+        size_t write_raw(const char* s, size_t n)
+        {
+            if(unlocked_)
+            {
+#ifdef NOWIDE_MSVC
+                return ::_fwrite_nolock(s, 1, n, file_);
+#elif !defined(NOWIDE_WINDOWS)
+                if(n == 1)
+                    return (putc_unlocked(*s, file_) == EOF) ? 0 : 1;
+#endif
+            }
+            return std::fwrite(s, 1, n, file_);
+        }
+        /// Write n1 bytes from s1 followed by n2 bytes from s2, less only on error
+        size_t write_raw(const char* s1, size_t n1, const char* s2, size_t n2)
+        {
+            const size_t result = n1 ? write_raw(s1, n1) : 0;
+            if(result != n1 || n2 == 0)
+                return result;
+            return result + write_raw(s2, n2);
+        }
+        bool flush_file()
+        {
+            return std::fflush(file_) == 0;
+        }
+        /// Set the file position and return it, -1 on error
+        /// Uses 64 bit offsets
+        std::streamoff seek_raw(std::streamoff off, int whence)
+        {
+#ifdef NOWIDE_WINDOWS
+            if(::_fseeki64(file_, off, whence) != 0)
+                return -1;
+            return ::_ftelli64(file_);
+#else
+            if(static_cast<detail::large_off_t>(off) != off)
+                return -1;
+            if(detail::large_fseek(file_, static_cast<detail::large_off_t>(off), whence) != 0)
+                return -1;
+            return detail::large_ftell(file_);
+#endif
+        }
+#endif
+
+        /// Mode strings for fopen
+        struct mode_strings
+        {
+            std::ios_base::openmode mode;
+            const wchar_t* wide;
+            const char* narrow;
+        };
+        static const mode_strings* find_mode(std::ios_base::openmode mode)
+        {
+            //
+            // done according to n2914 table 106 27.9.1.4
+            //
+            typedef std::ios_base base;
+            static const mode_strings modes[] = {
+              {base::out, L"w", "w"},
+              {base::out | base::app, L"a", "a"},
+              {base::app, L"a", "a"},
+              {base::out | base::trunc, L"w", "w"},
+              {base::in, L"r", "r"},
+              {base::in | base::out, L"r+", "r+"},
+              {base::in | base::out | base::trunc, L"w+", "w+"},
+              {base::in | base::out | base::app, L"a+", "a+"},
+              {base::in | base::app, L"a+", "a+"},
+              {base::binary | base::out, L"wb", "wb"},
+              {base::binary | base::out | base::app, L"ab", "ab"},
+              {base::binary | base::app, L"ab", "ab"},
+              {base::binary | base::out | base::trunc, L"wb", "wb"},
+              {base::binary | base::in, L"rb", "rb"},
+              {base::binary | base::in | base::out, L"r+b", "r+b"},
+              {base::binary | base::in | base::out | base::trunc, L"w+b", "w+b"},
+              {base::binary | base::in | base::out | base::app, L"a+b", "a+b"},
+              {base::binary | base::in | base::app, L"a+b", "a+b"},
+            };
+            for(size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+            {
+                if(modes[i].mode == mode)
+                    return &modes[i];
+            }
+            return 0;
+        }
+        static const wchar_t* get_mode(std::ios_base::openmode mode)
+        {
+            const mode_strings* const strings = find_mode(mode);
+            return strings ? strings->wide : 0;
+        }
+        static const char* get_narrow_mode(std::ios_base::openmode mode)
+        {
+            const mode_strings* const strings = find_mode(mode);
+            return strings ? strings->narrow : 0;
+        }
+
+        size_t buffer_size_;
+        size_t max_buffer_size_;
+        char* buffer_;
+#if NOWIDE_USE_FD_FILEBUF
+        int fd_;
+#else
         FILE* file_;
+#endif
+        char* map_;
+        size_t map_size_;
+        /// Writer for filebuf_options::write_behind and its buffer
+        detail::background_writer* writer_;
+        char* behind_buffer_;
+        size_t behind_size_;
+        /// Position in the file or -1 if unknown
+        std::streamoff file_pos_;
+        /// The file pointer still has to be moved to file_pos_ before the next read or write
+        bool seek_pending_;
+        /// Data was written since the file was last flushed
+        bool unflushed_;
         bool owns_buffer_;
+        bool sequential_;
+        /// Whether the file is currently opened for direct I/O, see filebuf_options::direct_io
+        /// Cleared by the background writer when it has to switch to cached I/O
+        std::atomic<bool> direct_;
+        /// See filebuf_options::unlocked
+        bool unlocked_;
+        /// See filebuf_options::keep_buffer
+        bool keep_buffer_;
         char last_char_;
         std::ios::openmode mode_;
     };
@@ -411,8 +1555,424 @@ namespace nowide {
     ///
     typedef basic_filebuf<char> filebuf;
 
+    ///
+    /// \brief Implementation of std::basic_filebuf for character types other than char
+    ///
+    /// The file content is always UTF-8 which is converted in bulk between an internal byte buffer
+    /// and the character buffer (UTF-16 or UTF-32 depending on the size of CharType).
+    /// The conversion uses the UTF traits directly instead of virtual calls to a codecvt facet,
+    /// hence the codecvt of the imbued locale is ignored.
+    /// The actual file access is done by basic_filebuf<char>.
+    ///
+    /// Invalid sequences are replaced by #NOWIDE_REPLACEMENT_CHARACTER.
+    /// As the encoding has a variable width, only seeks to the begin or end of the file and to positions
+    /// previously returned by seekoff/seekpos are supported (same as std::basic_filebuf)
+    ///
+    template<typename CharType, typename Traits>
+    class basic_filebuf : public std::basic_streambuf<CharType, Traits>
+    {
+        // Non-copyable
+        basic_filebuf(const basic_filebuf&);
+        basic_filebuf& operator=(const basic_filebuf&);
+
+        typedef detail::utf::utf_traits<CharType> wide_traits;
+        typedef detail::utf::utf_traits<char> utf8_traits;
+
+    public:
+        typedef CharType char_type;
+        typedef Traits traits_type;
+        typedef typename Traits::int_type int_type;
+        typedef typename Traits::pos_type pos_type;
+        typedef typename Traits::off_type off_type;
+
+        ///
+        /// Creates new filebuf
+        ///
+        basic_filebuf() :
+            buffer_size_(BUFSIZ), buffer_(0), owns_buffer_(false), bytes_(0), bytes_next_(0), bytes_end_(0),
+            mode_(std::ios_base::openmode(0))
+        {
+            this->setg(0, 0, 0);
+            this->setp(0, 0);
+        }
+
+        virtual ~basic_filebuf()
+        {
+            close();
+            if(owns_buffer_)
+                delete[] buffer_;
+            delete[] bytes_;
+        }
+
+        ///
+        /// Same as std::filebuf::open but s is UTF-8 string
+        /// The \a options apply to the underlying byte buffer
+        ///
+        basic_filebuf* open(const std::string& s,
+                            std::ios_base::openmode mode,
+                            const filebuf_options& options = filebuf_options())
+        {
+            return open(s.c_str(), mode, options);
+        }
+        ///
+        /// Same as std::filebuf::open but s is UTF-8 string
+        /// The \a options apply to the underlying byte buffer
+        ///
+        basic_filebuf*
+        open(const char* s, std::ios_base::openmode mode, const filebuf_options& options = filebuf_options())
+        {
+            if(is_open() || !file_.open(s, mode, options))
+                return NULL;
+            mode_ = mode;
+            return this;
+        }
+        /// Opens the file with the given name, see std::filebuf::open
+        basic_filebuf*
+        open(const wchar_t* s, std::ios_base::openmode mode, const filebuf_options& options = filebuf_options())
+        {
+            if(is_open() || !file_.open(s, mode, options))
+                return NULL;
+            mode_ = mode;
+            return this;
+        }
+        ///
+        /// Same as std::filebuf::close()
+        ///
+        basic_filebuf* close()
+        {
+            if(!is_open())
+                return NULL;
+            bool res = stop_writing() && stop_reading();
+            if(!file_.close())
+                res = false;
+            mode_ = std::ios_base::openmode(0);
+            return res ? this : NULL;
+        }
+        ///
+        /// Same as std::filebuf::is_open()
+        ///
+        bool is_open() const
+        {
+            return file_.is_open();
+        }
+
+    private:
+        /// Size of the byte buffer, must be able to hold at least 1 UTF-8 sequence
+        size_t bytes_size() const
+        {
+            return (std::max)(buffer_size_, static_cast<size_t>(utf8_traits::max_width));
+        }
+        void make_buffer()
+        {
+            if(!buffer_)
+            {
+                buffer_ = new char_type[buffer_size_];
+                owns_buffer_ = true;
+            }
+            if(!bytes_)
+                bytes_next_ = bytes_end_ = bytes_ = new char[bytes_size()];
+        }
+
+    protected:
+        virtual std::basic_streambuf<CharType, Traits>* setbuf(char_type* s, std::streamsize n)
+        {
+            assert(n >= 0);
+            // Same as for basic_filebuf<char>: Discard all local buffers and use user-provided values
+            // As a surrogate pair must fit into the buffer there is no unbuffered mode
+            this->setg(NULL, NULL, NULL);
+            this->setp(NULL, NULL);
+            if(owns_buffer_)
+                delete[] buffer_;
+            delete[] bytes_;
+            bytes_next_ = bytes_end_ = bytes_ = NULL;
+            const size_t min_size = wide_traits::max_width;
+            if(s && n >= static_cast<std::streamsize>(min_size))
+            {
+                buffer_ = s;
+                buffer_size_ = static_cast<size_t>(n);
+                owns_buffer_ = false;
+            } else
+            {
+                buffer_ = NULL;
+                buffer_size_ = (std::max)(static_cast<size_t>(n), min_size);
+            }
+            return this;
+        }
+
+        virtual int_type overflow(int_type c = traits_type::eof())
+        {
+            if(!(mode_ & std::ios_base::out))
+                return traits_type::eof();
+            if(!stop_reading())
+                return traits_type::eof();
+            if(this->pptr())
+            {
+                if(!write_put_area(false))
+                    return traits_type::eof();
+            } else
+            {
+                make_buffer();
+                this->setp(buffer_, buffer_ + buffer_size_);
+            }
+            if(!traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                if(this->pptr() == this->epptr())
+                    return traits_type::eof();
+                *this->pptr() = traits_type::to_char_type(c);
+                this->pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        virtual int sync()
+        {
+            if(!is_open())
+                return 0;
+            bool result;
+            if(this->pptr())
+                result = write_put_area(false) && file_.pubsync() == 0;
+            else
+                result = stop_reading();
+            return result ? 0 : -1;
+        }
+
+        virtual int_type underflow()
+        {
+            if(!(mode_ & std::ios_base::in))
+                return traits_type::eof();
+            if(!stop_writing())
+                return traits_type::eof();
+            make_buffer();
+            // Move an incomplete sequence left from the last read to the front
+            const size_t leftover = bytes_end_ - bytes_next_;
+            std::memmove(bytes_, bytes_next_, leftover);
+            bytes_end_ = bytes_ + leftover;
+            for(;;)
+            {
+                const std::streamsize n = file_.sgetn(bytes_end_, bytes_size() - (bytes_end_ - bytes_));
+                if(n > 0)
+                    bytes_end_ += n;
+                const bool at_eof = n <= 0;
+                char_type* const end = decode(at_eof);
+                this->setg(buffer_, buffer_, end);
+                if(end != buffer_)
+                    return traits_type::to_int_type(*this->gptr());
+                if(at_eof)
+                    return traits_type::eof();
+            }
+        }
+
+        virtual int_type pbackfail(int_type c = traits_type::eof())
+        {
+            // Only the current buffer can be used, see class description
+            if(!(mode_ & std::ios_base::in) || this->gptr() <= this->eback())
+                return traits_type::eof();
+            this->gbump(-1);
+            if(!traits_type::eq_int_type(c, traits_type::eof()))
+                *this->gptr() = traits_type::to_char_type(c);
+            return traits_type::not_eof(c);
+        }
+
+        virtual pos_type seekoff(off_type off,
+                                 std::ios_base::seekdir seekdir,
+                                 std::ios_base::openmode = std::ios_base::in | std::ios_base::out)
+        {
+            if(!is_open() || off != 0)
+                return pos_type(off_type(-1));
+            if(seekdir == std::ios_base::cur)
+            {
+                if(this->pptr())
+                {
+                    // A pending high surrogate has no byte position
+                    if(!write_put_area(false) || this->pptr() != this->pbase())
+                        return pos_type(off_type(-1));
+                    return file_.pubseekoff(0, std::ios_base::cur);
+                }
+                const off_type unread = unread_bytes();
+                if(unread < 0)
+                    return pos_type(off_type(-1));
+                const pos_type pos = file_.pubseekoff(0, std::ios_base::cur);
+                if(pos == pos_type(off_type(-1)))
+                    return pos;
+                return pos - unread;
+            }
+            if(!stop_writing() || !stop_reading())
+                return pos_type(off_type(-1));
+            return file_.pubseekoff(0, seekdir);
+        }
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode = std::ios_base::in | std::ios_base::out)
+        {
+            if(!is_open() || !stop_writing() || !stop_reading())
+                return pos_type(off_type(-1));
+            return file_.pubseekpos(pos);
+        }
+
+    private:
+        /// Decode the byte buffer into the character buffer.
+        /// An incomplete sequence at the end is kept for the next read unless \a at_eof is set
+        /// Return: End of the decoded characters
+        char_type* decode(bool at_eof)
+        {
+            const char* from = bytes_;
+            char_type* to = buffer_;
+            char_type* const to_end = buffer_ + buffer_size_;
+            while(from != bytes_end_)
+            {
+                const char* const seq = from;
+                detail::utf::code_point c = utf8_traits::decode(from, static_cast<const char*>(bytes_end_));
+                if(c == detail::utf::incomplete && !at_eof)
+                {
+                    from = seq;
+                    break;
+                }
+                if(c == detail::utf::illegal || c == detail::utf::incomplete)
+                    c = NOWIDE_REPLACEMENT_CHARACTER;
+                if(wide_traits::width(c) > to_end - to)
+                {
+                    from = seq;
+                    break;
+                }
+                to = wide_traits::encode(c, to);
+            }
+            bytes_next_ = bytes_ + (from - bytes_);
+            return to;
+        }
+
+        /// Number of bytes in the byte buffer which correspond to unread characters
+        /// Return: -1 if the read position is in the middle of a surrogate pair
+        off_type unread_bytes() const
+        {
+            if(!this->gptr())
+                return 0;
+            const char* from = bytes_;
+            // Redo the decoding up to the read position, so the count is exact even for invalid sequences
+            for(std::ptrdiff_t n = this->gptr() - this->eback(); n > 0;)
+            {
+                detail::utf::code_point c = utf8_traits::decode(from, static_cast<const char*>(bytes_end_));
+                if(c == detail::utf::illegal || c == detail::utf::incomplete)
+                    c = NOWIDE_REPLACEMENT_CHARACTER;
+                n -= wide_traits::width(c);
+                if(n < 0)
+                    return -1;
+            }
+            return bytes_end_ - from;
+        }
+
+        /// Convert the put area to UTF-8 and write it to the file.
+        /// A trailing incomplete surrogate pair is kept in the put area unless \a final is set
+        bool write_put_area(bool final)
+        {
+            const char_type* from = this->pbase();
+            const char_type* const end = this->pptr();
+            char* to = bytes_;
+            char* const to_end = bytes_ + bytes_size();
+            bool result = true;
+            while(from != end)
+            {
+                const char_type* const seq = from;
+                detail::utf::code_point c = wide_traits::decode(from, end);
+                if(c == detail::utf::incomplete && !final)
+                {
+                    from = seq;
+                    break;
+                }
+                if(c == detail::utf::illegal || c == detail::utf::incomplete)
+                    c = NOWIDE_REPLACEMENT_CHARACTER;
+                if(utf8_traits::width(c) > to_end - to)
+                {
+                    result = write_bytes(to);
+                    to = bytes_;
+                }
+                to = utf8_traits::encode(c, to);
+            }
+            if(!write_bytes(to))
+                result = false;
+            const size_t pending = end - from;
+            traits_type::move(buffer_, from, pending);
+            this->setp(buffer_, buffer_ + buffer_size_);
+            this->pbump(static_cast<int>(pending));
+            return result;
+        }
+        bool write_bytes(const char* end)
+        {
+            const std::streamsize n = end - bytes_;
+            return file_.sputn(bytes_, n) == n;
+        }
+
+        /// Stop reading adjusting the file pointer if necessary
+        /// Postcondition: gptr() == NULL
+        bool stop_reading()
+        {
+            if(this->gptr())
+            {
+                const off_type unread = unread_bytes();
+                this->setg(0, 0, 0);
+                bytes_next_ = bytes_end_ = bytes_;
+                if(unread < 0)
+                    return false;
+                if(unread && file_.pubseekoff(-unread, std::ios_base::cur) == pos_type(off_type(-1)))
+                    return false;
+            }
+            return true;
+        }
+
+        /// Stop writing. If any characters are to be written, writes them to file
+        /// Postcondition: pptr() == NULL
+        bool stop_writing()
+        {
+            if(this->pptr())
+            {
+                const bool result = write_put_area(true);
+                this->setp(0, 0);
+                return result;
+            }
+            return true;
+        }
+
+        basic_filebuf<char> file_;
+        size_t buffer_size_;
+        char_type* buffer_;
+        bool owns_buffer_;
+        char* bytes_;
+        char* bytes_next_;
+        char* bytes_end_;
+        std::ios::openmode mode_;
+    };
+
+    ///
+    /// \brief Copy the rest of the file opened by \a from to the file opened by \a to
+    ///
+    /// Data already buffered in \a from and \a to is taken into account. If both use file descriptors
+    /// (#NOWIDE_USE_FD_FILEBUF) the data is copied by the kernel with copy_file_range or sendfile,
+    /// otherwise a large buffer is used.
+    /// Returns the number of bytes copied or -1 on error
+    ///
+    inline std::streamsize copy_file_contents(basic_filebuf<char>& from, basic_filebuf<char>& to)
+    {
+        return from.copy_to(to);
+    }
+
 #endif // windows
 
+#if !NOWIDE_USE_FILEBUF_REPLACEMENT && !defined(NOWIDE_DOXYGEN)
+    inline std::streamsize copy_file_contents(std::filebuf& from, std::filebuf& to)
+    {
+        if(!from.is_open() || !to.is_open())
+            return -1;
+        std::vector<char> buffer(64 * 1024);
+        std::streamsize total = 0;
+        for(;;)
+        {
+            const std::streamsize n = from.sgetn(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+            if(n <= 0)
+                return total;
+            if(to.sputn(&buffer[0], n) != n)
+                return -1;
+            total += n;
+        }
+    }
+#endif
+
 } // namespace nowide
 
 
@@ -0,0 +1,154 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_FILEBUF_POOL_HPP_INCLUDED
+#define NOWIDE_FILEBUF_POOL_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/convert.hpp>
+#include <nowide/filebuf.hpp>
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace nowide {
+    ///
+    /// \brief Pool of filebufs which are reused to open many files one after another
+    ///
+    /// A released filebuf keeps its buffer (see filebuf_options::keep_buffer), so opening a file from the pool
+    /// usually neither allocates a filebuf nor a buffer.
+    ///
+    /// All filebufs are owned by the pool and destroyed with it.
+    ///
+    /// Only available with the replacement filebuf (#NOWIDE_USE_FILEBUF_REPLACEMENT)
+    ///
+    class filebuf_pool
+    {
+        // Non-copyable
+        filebuf_pool(const filebuf_pool&);
+        filebuf_pool& operator=(const filebuf_pool&);
+
+    public:
+        ///
+        /// Create a pool opening all files with \a options
+        ///
+        explicit filebuf_pool(const filebuf_options& options = filebuf_options()) : options_(options)
+        {
+            options_.keep_buffer = true;
+        }
+        ///
+        /// Closes and destroys all filebufs of the pool, also those not released
+        ///
+        ~filebuf_pool()
+        {
+            for(size_t i = 0; i < all_.size(); i++)
+                delete all_[i];
+        }
+
+        ///
+        /// Open the UTF-8 file name \a file_name with a filebuf from the pool.
+        /// Returns NULL on failure, otherwise the filebuf which must be given back with release()
+        ///
+        basic_filebuf<char>* open(const char* file_name, std::ios_base::openmode mode)
+        {
+            basic_filebuf<char>* const buf = acquire();
+            if(!buf->open(file_name, mode, options_))
+            {
+                free_.push_back(buf);
+                return NULL;
+            }
+            return buf;
+        }
+        ///
+        /// Open \a count files, the filebuf for \a file_names[i] is stored in \a files[i] or NULL if it failed.
+        /// The file names are converted in one go when the filebuf uses wide file names.
+        /// Returns the number of files opened
+        ///
+        size_t open_many(const char* const* file_names,
+                         size_t count,
+                         std::ios_base::openmode mode,
+                         basic_filebuf<char>** files)
+        {
+#if NOWIDE_USE_FD_FILEBUF || !defined(NOWIDE_WINDOWS)
+            const char* const* names = file_names;
+#else
+            // Each UTF-8 byte yields at most one UTF-16/32 code unit
+            std::vector<size_t> offsets(count);
+            size_t size = 0;
+            for(size_t i = 0; i < count; i++)
+            {
+                offsets[i] = size;
+                size += std::strlen(file_names[i]) + 1;
+            }
+            std::vector<wchar_t> arena(size);
+            std::vector<const wchar_t*> names(count);
+            for(size_t i = 0; i < count; i++)
+            {
+                wchar_t* const name = &arena[offsets[i]];
+                const size_t name_size = ((i + 1 < count) ? offsets[i + 1] : size) - offsets[i];
+                names[i] = widen(name, name_size, file_names[i]);
+            }
+#endif
+            size_t result = 0;
+            for(size_t i = 0; i < count; i++)
+            {
+                files[i] = NULL;
+                basic_filebuf<char>* const buf = acquire();
+                if(names[i] && buf->open(names[i], mode, options_))
+                {
+                    files[i] = buf;
+                    result++;
+                } else
+                    free_.push_back(buf);
+            }
+            return result;
+        }
+        ///
+        /// Close \a buf and give it back to the pool. Returns false if closing failed.
+        /// \a buf must have been returned by open() or open_many() of this pool and not been released since
+        ///
+        bool release(basic_filebuf<char>* buf)
+        {
+            assert(std::find(all_.begin(), all_.end(), buf) != all_.end());
+            assert(std::find(free_.begin(), free_.end(), buf) == free_.end());
+            const bool result = !buf->is_open() || buf->close();
+            free_.push_back(buf);
+            return result;
+        }
+        ///
+        /// Number of filebufs not in use
+        ///
+        size_t available() const
+        {
+            return free_.size();
+        }
+
+    private:
+        basic_filebuf<char>* acquire()
+        {
+            if(free_.empty())
+            {
+                all_.push_back(new basic_filebuf<char>());
+                return all_.back();
+            }
+            basic_filebuf<char>* const result = free_.back();
+            free_.pop_back();
+            return result;
+        }
+
+        filebuf_options options_;
+        std::vector<basic_filebuf<char>*> all_;
+        std::vector<basic_filebuf<char>*> free_;
+    };
+} // namespace nowide
+
+#endif
+
+#endif
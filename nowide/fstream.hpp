@@ -260,6 +260,21 @@ namespace nowide {
                 else
                     clear();
             }
+#endif
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+            /// Open the file using the given \a options, see filebuf_options
+            void open(const std::string& file_name, std::ios_base::openmode mode, const filebuf_options& options)
+            {
+                open(file_name.c_str(), mode, options);
+            }
+            /// Open the file using the given \a options, see filebuf_options
+            void open(const char* file_name, std::ios_base::openmode mode, const filebuf_options& options)
+            {
+                if(!rdbuf()->open(file_name, mode | T_StreamType::mode_modifier(), options))
+                    setstate(std::ios_base::failbit);
+                else
+                    clear();
+            }
 #endif
             bool is_open()
             {
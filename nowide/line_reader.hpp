@@ -0,0 +1,105 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_LINE_READER_HPP_INCLUDED
+#define NOWIDE_LINE_READER_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/filebuf.hpp>
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace nowide {
+    ///
+    /// \brief Reads lines from a filebuf by searching the newlines directly in its buffer
+    ///
+    /// Lines are returned as pointers into the buffer of the filebuf, so no copy is made unless a line spans
+    /// more than one buffer. With a memory mapped file (see filebuf_options::memory_map) no line is ever copied.
+    /// Lines are separated by '\\n' which is not part of the line, a '\\r' before it is kept.
+    ///
+    /// The filebuf can be used as usual between calls, reading continues after the last line returned.
+    ///
+    /// Only available with the replacement filebuf (#NOWIDE_USE_FILEBUF_REPLACEMENT)
+    ///
+    class line_reader
+    {
+        // Non-copyable
+        line_reader(const line_reader&);
+        line_reader& operator=(const line_reader&);
+
+    public:
+        explicit line_reader(basic_filebuf<char>& buf) : buf_(buf)
+        {}
+
+        ///
+        /// Read the next line and point \a data to its \a size characters.
+        /// The line stays valid until the next call or until the filebuf is used otherwise.
+        /// Returns false at the end of the file
+        ///
+        bool next(const char*& data, size_t& size)
+        {
+            bool have_carry = false;
+            carry_.clear();
+            for(;;)
+            {
+                if(buf_.gptr() == buf_.egptr() && buf_.sgetc() == EOF)
+                {
+                    // Last line without a newline
+                    if(!have_carry)
+                        return false;
+                    data = carry_.data();
+                    size = carry_.size();
+                    return true;
+                }
+                char* const begin = buf_.gptr();
+                char* const end = buf_.egptr();
+                char* const newline = static_cast<char*>(std::memchr(begin, '\n', end - begin));
+                if(newline)
+                {
+                    buf_.setg(buf_.eback(), newline + 1, end);
+                    if(!have_carry)
+                    {
+                        data = begin;
+                        size = newline - begin;
+                    } else
+                    {
+                        carry_.append(begin, newline);
+                        data = carry_.data();
+                        size = carry_.size();
+                    }
+                    return true;
+                }
+                // The line continues in the next buffer
+                carry_.append(begin, end);
+                have_carry = true;
+                buf_.setg(buf_.eback(), end, end);
+            }
+        }
+        ///
+        /// Read the next line into \a line. Returns false at the end of the file
+        ///
+        bool next(std::string& line)
+        {
+            const char* data;
+            size_t size;
+            if(!next(data, size))
+                return false;
+            line.assign(data, size);
+            return true;
+        }
+
+    private:
+        basic_filebuf<char>& buf_;
+        std::string carry_;
+    };
+} // namespace nowide
+
+#endif
+
+#endif
@@ -0,0 +1,257 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_PARALLEL_FILE_READER_HPP_INCLUDED
+#define NOWIDE_PARALLEL_FILE_READER_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/detail/positional_file.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <ios>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace nowide {
+    ///
+    /// \brief Options for parallel_file_reader
+    ///
+    struct parallel_file_reader_options
+    {
+        ///
+        /// Number of ranges the file is split into. 0 (default) uses one range per hardware thread
+        ///
+        size_t num_ranges;
+        ///
+        /// Size of the buffer of each range in bytes. Default is 1 MiB
+        ///
+        size_t buffer_size;
+        ///
+        /// If not EOF (default): Ranges and chunks end after this character (as unsigned char),
+        /// e.g. '\\n' so lines are never split
+        ///
+        int delimiter;
+
+        parallel_file_reader_options() : num_ranges(0), buffer_size(1024 * 1024), delimiter(EOF)
+        {}
+    };
+
+    ///
+    /// \brief Reads a file by splitting it into byte ranges which are processed in parallel
+    ///
+    /// Each range is read with its own buffer using positional reads, so all ranges share the same open file.
+    /// The ranges are processed by threads started for each call to read(), including the calling thread,
+    /// so handlers may use other I/O facilities like async_filebuf or even a nested parallel_file_reader.
+    ///
+    /// The file name is UTF-8 as for nowide::ifstream and the file is always opened in binary mode.
+    ///
+    class parallel_file_reader
+    {
+        // Non-copyable
+        parallel_file_reader(const parallel_file_reader&);
+        parallel_file_reader& operator=(const parallel_file_reader&);
+
+    public:
+        ///
+        /// Function called with the index of the range and a chunk of its data
+        ///
+        typedef std::function<void(size_t range, const char* data, size_t size)> chunk_handler;
+
+        explicit parallel_file_reader(const parallel_file_reader_options& options = parallel_file_reader_options()) :
+            options_(options)
+        {
+            init_options();
+        }
+        explicit parallel_file_reader(const char* file_name,
+                                      const parallel_file_reader_options& options = parallel_file_reader_options()) :
+            options_(options)
+        {
+            init_options();
+            open(file_name);
+        }
+
+        ///
+        /// Open the UTF-8 file name \a file_name, returns false on failure
+        ///
+        bool open(const char* file_name)
+        {
+            return file_.open(file_name, std::ios_base::in);
+        }
+        bool open(const std::string& file_name)
+        {
+            return open(file_name.c_str());
+        }
+        bool is_open() const
+        {
+            return file_.is_open();
+        }
+        bool close()
+        {
+            return file_.close();
+        }
+
+        ///
+        /// Start and end offsets of the ranges the file is split into.
+        /// With a delimiter each boundary is moved to just after the next delimiter,
+        /// so ranges might be empty. Returns an empty vector on error
+        ///
+        std::vector<std::streamoff> boundaries()
+        {
+            std::vector<std::streamoff> result;
+            const std::streamoff size = file_.size();
+            if(size < 0)
+                return result;
+            const std::streamoff num_ranges = static_cast<std::streamoff>(options_.num_ranges);
+            result.push_back(0);
+            for(std::streamoff i = 1; i < num_ranges; i++)
+            {
+                std::streamoff pos = size / num_ranges * i + size % num_ranges * i / num_ranges;
+                if(options_.delimiter != EOF)
+                    pos = after_delimiter(pos, size);
+                result.push_back((std::max)(pos, result.back()));
+            }
+            result.push_back(size);
+            return result;
+        }
+
+        ///
+        /// Read the whole file calling \a handler for the data of each range.
+        /// The data of a range is passed in consecutive chunks in order, chunks of different ranges concurrently.
+        /// With a delimiter each chunk ends after a delimiter or at the end of the file, so records are never split.
+        /// Returns false if reading failed. An exception thrown by \a handler is rethrown after all ranges finished
+        ///
+        bool read(const chunk_handler& handler)
+        {
+            if(!is_open())
+                return false;
+            const std::vector<std::streamoff> bounds = boundaries();
+            if(bounds.empty())
+                return false;
+            const size_t num_ranges = bounds.size() - 1;
+            std::atomic<size_t> next_range(0);
+            std::mutex mutex;
+            bool result = true;
+            std::exception_ptr error;
+            const std::function<void()> worker = [&]() {
+                for(size_t i = next_range++; i < num_ranges; i = next_range++)
+                {
+                    try
+                    {
+                        if(!read_range(handler, i, bounds[i], bounds[i + 1]))
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            result = false;
+                        }
+                    } catch(...)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(!error)
+                            error = std::current_exception();
+                    }
+                }
+            };
+            // The threads mostly wait for I/O, so use at least a few
+            const size_t num_threads =
+              (std::min)(num_ranges, static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 4u)));
+            std::vector<std::thread> threads;
+            try
+            {
+                for(size_t i = 1; i < num_threads; i++)
+                    threads.push_back(std::thread(worker));
+            } catch(const std::system_error&)
+            {
+                // Continue with the threads started so far
+            }
+            worker();
+            for(size_t i = 0; i < threads.size(); i++)
+                threads[i].join();
+            if(error)
+                std::rethrow_exception(error);
+            return result;
+        }
+
+    private:
+        void init_options()
+        {
+            if(options_.num_ranges == 0)
+                options_.num_ranges = (std::max)(std::thread::hardware_concurrency(), 1u);
+            if(options_.buffer_size == 0)
+                options_.buffer_size = 1;
+        }
+        /// Position after the first delimiter at or after pos - 1, the end of the file if there is none
+        std::streamoff after_delimiter(std::streamoff pos, std::streamoff size)
+        {
+            if(pos == 0)
+                return 0;
+            char block[4096];
+            for(pos--; pos < size;)
+            {
+                const size_t n = file_.read_at(
+                  block, static_cast<size_t>((std::min)(static_cast<std::streamoff>(sizeof(block)), size - pos)), pos);
+                if(n == 0)
+                    break;
+                const char* const delimiter = static_cast<const char*>(std::memchr(block, options_.delimiter, n));
+                if(delimiter)
+                    return pos + (delimiter - block) + 1;
+                pos += n;
+            }
+            return size;
+        }
+        bool read_range(const chunk_handler& handler, size_t range, std::streamoff pos, std::streamoff end)
+        {
+            std::vector<char> buffer(options_.buffer_size);
+            // Start of the buffer not passed to the handler yet
+            size_t pending = 0;
+            while(pos < end)
+            {
+                // A record larger than the buffer
+                if(pending == buffer.size())
+                    buffer.resize(buffer.size() * 2);
+                const size_t n =
+                  static_cast<size_t>((std::min)(static_cast<std::streamoff>(buffer.size() - pending), end - pos));
+                if(file_.read_at(&buffer[pending], n, pos) != n)
+                    return false;
+                pos += n;
+                const size_t size = pending + n;
+                size_t chunk_size = size;
+                if(options_.delimiter != EOF && pos < end)
+                {
+                    // Only whole records, pending data contains no delimiter
+                    const char delimiter = static_cast<char>(options_.delimiter);
+                    chunk_size = 0;
+                    for(size_t i = size; i > pending; i--)
+                    {
+                        if(buffer[i - 1] == delimiter)
+                        {
+                            chunk_size = i;
+                            break;
+                        }
+                    }
+                }
+                if(chunk_size > 0)
+                    handler(range, &buffer[0], chunk_size);
+                pending = size - chunk_size;
+                if(pending > 0 && chunk_size > 0)
+                    std::memmove(&buffer[0], &buffer[chunk_size], pending);
+            }
+            return true;
+        }
+
+        parallel_file_reader_options options_;
+        detail::positional_file file_;
+    };
+} // namespace nowide
+
+#endif
@@ -0,0 +1,360 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_PARALLEL_FILE_WRITER_HPP_INCLUDED
+#define NOWIDE_PARALLEL_FILE_WRITER_HPP_INCLUDED
+
+#include <nowide/config.hpp>
+#include <nowide/filebuf.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <ios>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nowide {
+    ///
+    /// \brief Options for parallel_file_writer
+    ///
+    struct parallel_file_writer_options
+    {
+        ///
+        /// Size of the buffer each writer uses per file in bytes. Default is 64 KiB
+        ///
+        size_t buffer_size;
+        ///
+        /// Maximum number of full buffers waiting for the I/O thread, more writes wait until some are written.
+        /// Default is 64
+        ///
+        size_t max_pending;
+
+        parallel_file_writer_options() : buffer_size(64 * 1024), max_pending(64)
+        {}
+    };
+
+    ///
+    /// \brief Writes to many files from many threads without locking on each write
+    ///
+    /// Each thread writes through its own parallel_file_writer::writer, which collects the data in one buffer per file.
+    /// Full buffers are passed to a dedicated I/O thread writing them in batches to the files.
+    /// Data written by one writer to a file keeps its order. Data of different writers is interleaved
+    /// but the data of a single write is never split. Errors are reported by the next write, flush or close.
+    ///
+    /// The file names are UTF-8 as for nowide::ofstream. All files must be opened before the first writer is created
+    /// and all writers must be destroyed before the parallel_file_writer is closed.
+    ///
+    class parallel_file_writer
+    {
+        // Non-copyable
+        parallel_file_writer(const parallel_file_writer&);
+        parallel_file_writer& operator=(const parallel_file_writer&);
+
+        struct chunk
+        {
+            size_t file;
+            char* data;
+            size_t size;
+        };
+
+    public:
+        ///
+        /// \brief Writes the data of one thread to the files of a parallel_file_writer
+        ///
+        class writer
+        {
+            // Non-copyable
+            writer(const writer&);
+            writer& operator=(const writer&);
+
+        public:
+            explicit writer(parallel_file_writer& parent) : parent_(parent), buffers_(parent.num_files())
+            {
+                for(size_t i = 0; i < buffers_.size(); i++)
+                {
+                    buffers_[i].file = i;
+                    buffers_[i].data = NULL;
+                    buffers_[i].size = 0;
+                }
+            }
+            ///
+            /// Passes all buffered data to the I/O thread, errors are ignored
+            ///
+            ~writer()
+            {
+                flush();
+                for(size_t i = 0; i < buffers_.size(); i++)
+                {
+                    if(buffers_[i].data)
+                        parent_.release_buffer(buffers_[i].data);
+                }
+            }
+
+            ///
+            /// Write \a n bytes from \a s to the file with index \a file (in the order the files were opened).
+            /// Returns false if writing to any file failed
+            ///
+            bool write(size_t file, const char* s, size_t n)
+            {
+                assert(file < buffers_.size());
+                chunk& c = buffers_[file];
+                const size_t buffer_size = parent_.options_.buffer_size;
+                // Keep the data of one write together
+                if(c.size + n > buffer_size && c.size > 0 && !hand_off(c))
+                    return false;
+                if(n > buffer_size)
+                {
+                    // Passed on in a buffer of its own
+                    chunk large;
+                    large.file = file;
+                    large.data = new char[n];
+                    large.size = n;
+                    std::memcpy(large.data, s, n);
+                    return hand_off(large) && !parent_.failed();
+                }
+                if(!c.data)
+                    c.data = parent_.get_buffer();
+                std::memcpy(c.data + c.size, s, n);
+                c.size += n;
+                if(c.size == buffer_size && !hand_off(c))
+                    return false;
+                return !parent_.failed();
+            }
+            ///
+            /// Write \a data to the file with index \a file. Returns false if writing to any file failed
+            ///
+            bool write(size_t file, const std::string& data)
+            {
+                return write(file, data.data(), data.size());
+            }
+            ///
+            /// Pass all buffered data to the I/O thread, use parallel_file_writer::flush to wait until it is written.
+            /// Returns false if writing to any file failed
+            ///
+            bool flush()
+            {
+                bool result = true;
+                for(size_t i = 0; i < buffers_.size(); i++)
+                {
+                    if(buffers_[i].size > 0 && !hand_off(buffers_[i]))
+                        result = false;
+                }
+                return result && !parent_.failed();
+            }
+
+        private:
+            bool hand_off(chunk& c)
+            {
+                const bool result = parent_.submit(c);
+                c.data = NULL;
+                c.size = 0;
+                return result;
+            }
+
+            parallel_file_writer& parent_;
+            std::vector<chunk> buffers_;
+        };
+
+        explicit parallel_file_writer(const parallel_file_writer_options& options = parallel_file_writer_options()) :
+            options_(options), stop_(false), busy_(false), failed_(false)
+        {
+            if(options_.buffer_size == 0)
+                options_.buffer_size = 1;
+            if(options_.max_pending == 0)
+                options_.max_pending = 1;
+            thread_ = std::thread(&parallel_file_writer::run, this);
+        }
+        ///
+        /// Closes all files, errors are ignored
+        ///
+        ~parallel_file_writer()
+        {
+            close();
+            for(size_t i = 0; i < free_.size(); i++)
+                delete[] free_[i];
+        }
+
+        ///
+        /// Open the UTF-8 file name \a file_name as the file with the next index, returns false on failure
+        ///
+        bool open(const char* file_name, std::ios_base::openmode mode = std::ios_base::out | std::ios_base::binary)
+        {
+            if(!thread_.joinable())
+                return false;
+            filebuf* const file = new filebuf();
+            if(!file->open(file_name, mode | std::ios_base::out))
+            {
+                delete file;
+                return false;
+            }
+            files_.push_back(file);
+            return true;
+        }
+        bool open(const std::string& file_name,
+                  std::ios_base::openmode mode = std::ios_base::out | std::ios_base::binary)
+        {
+            return open(file_name.c_str(), mode);
+        }
+        ///
+        /// Number of open files
+        ///
+        size_t num_files() const
+        {
+            return files_.size();
+        }
+
+        ///
+        /// Wait until all data passed to the I/O thread is written and sync all files.
+        /// Data still buffered by writers is not included. Returns false if writing to any file failed
+        ///
+        bool flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while(!queue_.empty() || busy_)
+                done_cv_.wait(lock);
+            // The I/O thread cannot start writing while the lock is held
+            bool result = !failed_;
+            for(size_t i = 0; i < files_.size(); i++)
+            {
+                if(files_[i]->pubsync() != 0)
+                    result = false;
+            }
+            return result;
+        }
+        ///
+        /// Write all data passed to the I/O thread, stop it and close all files.
+        /// Returns false if writing to or closing any file failed
+        ///
+        bool close()
+        {
+            if(!thread_.joinable())
+                return false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            work_cv_.notify_one();
+            thread_.join();
+            bool result = !failed_;
+            for(size_t i = 0; i < files_.size(); i++)
+            {
+                if(!files_[i]->close())
+                    result = false;
+                delete files_[i];
+            }
+            files_.clear();
+            return result;
+        }
+
+    private:
+        /// Checked on every write, so without locking
+        bool failed() const
+        {
+            return failed_.load(std::memory_order_relaxed);
+        }
+        char* get_buffer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(!free_.empty())
+                {
+                    char* const result = free_.back();
+                    free_.pop_back();
+                    return result;
+                }
+            }
+            return new char[options_.buffer_size];
+        }
+        void release_buffer(char* buffer)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(buffer);
+        }
+        /// Return the buffer of a written chunk, must be called with the mutex locked
+        void release_chunk(const chunk& c)
+        {
+            // Larger chunks are single writes with their own buffer
+            if(c.size > options_.buffer_size)
+                delete[] c.data;
+            else
+                free_.push_back(c.data);
+        }
+        /// Queue a buffer for the I/O thread, false if writing failed before or the files were closed
+        bool submit(const chunk& c)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while(queue_.size() >= options_.max_pending && !failed_)
+                done_cv_.wait(lock);
+            if(failed_ || stop_)
+            {
+                release_chunk(c);
+                return false;
+            }
+            queue_.push_back(c);
+            lock.unlock();
+            work_cv_.notify_one();
+            return true;
+        }
+        void run()
+        {
+            std::vector<chunk> batch;
+            std::unique_lock<std::mutex> lock(mutex_);
+            for(;;)
+            {
+                while(queue_.empty() && !stop_)
+                    work_cv_.wait(lock);
+                // Write everything submitted before stopping
+                if(queue_.empty())
+                    return;
+                batch.swap(queue_);
+                busy_ = true;
+                lock.unlock();
+                // Writers waiting for space can continue
+                done_cv_.notify_all();
+                bool result = true;
+                for(size_t i = 0; i < batch.size(); i++)
+                {
+                    const std::streamsize size = static_cast<std::streamsize>(batch[i].size);
+                    if(files_[batch[i].file]->sputn(batch[i].data, size) != size)
+                        result = false;
+                }
+                lock.lock();
+                for(size_t i = 0; i < batch.size(); i++)
+                    release_chunk(batch[i]);
+                batch.clear();
+                if(!result)
+                    failed_ = true;
+                busy_ = false;
+                done_cv_.notify_all();
+            }
+        }
+
+        parallel_file_writer_options options_;
+        std::vector<filebuf*> files_;
+        std::mutex mutex_;
+        /// Signaled when buffers are queued or the I/O thread should stop
+        std::condition_variable work_cv_;
+        /// Signaled when the I/O thread took or finished a batch
+        std::condition_variable done_cv_;
+        std::vector<chunk> queue_;
+        /// Buffers not used by any writer
+        std::vector<char*> free_;
+        bool stop_;
+        /// Whether the I/O thread is writing a batch
+        bool busy_;
+        /// Set with the mutex locked, so waiting threads are notified reliably
+        std::atomic<bool> failed_;
+        std::thread thread_;
+    };
+} // namespace nowide
+
+#endif
@@ -17,6 +17,7 @@
 #endif
 
 #include <nowide/cstdio.hpp>
+#include <nowide/detail/large_file.hpp>
 #include <nowide/stackstring.hpp>
 
 
@@ -29,7 +30,8 @@ namespace nowide {
 #else
             const stackstring name(filename);
             const short_stackstring smode2(mode);
-            return std::fopen(name.get(), smode2.get());
+            // Also allow files larger than 2 GiB on 32 bit systems
+            return large_fopen(name.get(), smode2.get());
 #endif
         }
     } // namespace detail
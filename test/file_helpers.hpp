@@ -0,0 +1,58 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_LIB_FILE_HELPERS_H_INCLUDED
+#define NOWIDE_LIB_FILE_HELPERS_H_INCLUDED
+
+#include "test.hpp"
+#include <nowide/cstdio.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+/// Content of the UTF-8 file name \a filepath, empty if it can't be opened
+inline std::string read_file(const std::string& filepath)
+{
+    std::string result;
+    FILE* f = nowide::fopen(filepath.c_str(), "rb");
+    if(!f)
+        return result;
+    int c;
+    while((c = std::fgetc(f)) != EOF)
+        result += static_cast<char>(c);
+    std::fclose(f);
+    return result;
+}
+
+/// Create or overwrite the UTF-8 file name \a filepath with \a content
+inline void create_file(const std::string& filepath, const std::string& content)
+{
+    FILE* f = nowide::fopen(filepath.c_str(), "wb");
+    TEST(f);
+    TEST(std::fwrite(content.data(), 1, content.size(), f) == content.size());
+    std::fclose(f);
+}
+
+/// \a size bytes of the alphabet repeated
+inline std::string make_test_data(size_t size)
+{
+    std::string data(size, '\0');
+    for(size_t i = 0; i < size; i++)
+        data[i] = static_cast<char>('a' + i % 26);
+    return data;
+}
+
+/// Name of the \a i-th file with a non-ASCII character starting with \a prefix
+inline std::string make_filename(const std::string& prefix, size_t i)
+{
+    std::ostringstream s;
+    s << prefix << "-\xd7\xa9-" << i << ".txt";
+    return s.str();
+}
+
+#endif // #ifndef NOWIDE_LIB_FILE_HELPERS_H_INCLUDED
@@ -0,0 +1,153 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "file_helpers.hpp"
+#include "test.hpp"
+#include <nowide/async_fstream.hpp>
+#include <nowide/cstdio.hpp>
+#include <iostream>
+
+namespace nw = nowide;
+
+void test_write(const std::string& filepath, const nw::async_filebuf_options& options)
+{
+    const std::string data = make_test_data(100000);
+    {
+        nw::async_ofstream f(filepath, std::ios_base::out, options);
+        TEST(f);
+        TEST(f.put(data[0]));
+        for(size_t i = 1; i < 1000; i++)
+            TEST(f.write(&data[i * 100 - 99], 100));
+        TEST(f.tellp() == std::streampos(99901));
+        TEST(f.write(&data[99901], data.size() - 99901));
+        TEST(f.flush());
+        TEST(read_file(filepath) == data);
+        // Overwrite a part
+        TEST(f.seekp(500));
+        TEST(f.write("Hello", 5));
+        TEST(f.seekp(-1, std::ios_base::end));
+        TEST(f.put('!'));
+        f.close();
+        TEST(f);
+    }
+    std::string expected = data;
+    expected.replace(500, 5, "Hello");
+    expected[expected.size() - 1] = '!';
+    TEST(read_file(filepath) == expected);
+    // Append
+    {
+        nw::async_ofstream f(filepath, std::ios_base::app, options);
+        TEST(f);
+        TEST(f.tellp() == std::streampos(data.size()));
+        TEST(f << "World");
+    }
+    expected += "World";
+    TEST(read_file(filepath) == expected);
+    // Two appenders don't overwrite each other
+    {
+        nw::async_ofstream f1(filepath, std::ios_base::app, options);
+        nw::async_ofstream f2(filepath, std::ios_base::app, options);
+        TEST(f1.write(data.data(), data.size()));
+        TEST(f1.flush());
+        TEST(f2 << "Second");
+        TEST(f2.flush());
+        TEST(f1 << "First");
+    }
+    expected += data + "SecondFirst";
+    TEST(read_file(filepath) == expected);
+    TEST(nw::remove(filepath.c_str()) == 0);
+}
+
+void test_read(const std::string& filepath, const nw::async_filebuf_options& options)
+{
+    const std::string data = make_test_data(100000);
+    {
+        nw::async_ofstream f(filepath);
+        TEST(f.write(data.data(), data.size()));
+    }
+    {
+        nw::async_ifstream f(filepath, options);
+        TEST(f);
+        std::string content;
+        char c;
+        while(f.get(c))
+            content += c;
+        TEST(content == data);
+        TEST(f.eof());
+        f.clear();
+        // Random access
+        TEST(f.seekg(12345));
+        TEST(f.tellg() == std::streampos(12345));
+        TEST(f.get() == data[12345]);
+        TEST(f.seekg(-2, std::ios_base::cur));
+        TEST(f.get() == data[12344]);
+        TEST(f.seekg(-10, std::ios_base::end));
+        content.assign(10, '\0');
+        TEST(f.read(&content[0], 10));
+        TEST(content == data.substr(data.size() - 10));
+        TEST(f.get() == EOF);
+        f.clear();
+        TEST(f.seekg(0));
+        content.assign(data.size(), '\0');
+        TEST(f.read(&content[0], content.size()));
+        TEST(content == data);
+    }
+    {
+        nw::async_ifstream f((filepath + ".missing").c_str(), options);
+        TEST(!f);
+        TEST(!f.is_open());
+    }
+    TEST(nw::remove(filepath.c_str()) == 0);
+}
+
+void test_open_modes(const std::string& filepath)
+{
+    nw::async_filebuf buf;
+    TEST(!buf.open(filepath, std::ios_base::in | std::ios_base::out));
+    TEST(buf.open(filepath, std::ios_base::out));
+    TEST(buf.is_open());
+    TEST(!buf.open(filepath, std::ios_base::out));
+    TEST(buf.sputc('a') == 'a');
+    TEST(buf.close());
+    TEST(!buf.close());
+    TEST(buf.open(filepath, std::ios_base::in));
+    TEST(buf.sputc('b') == EOF);
+    TEST(buf.sbumpc() == 'a');
+    TEST(buf.sbumpc() == EOF);
+    TEST(buf.close());
+    TEST(read_file(filepath) == "a");
+    TEST(nw::remove(filepath.c_str()) == 0);
+}
+
+int main(int, char** argv)
+{
+    const std::string exampleFilename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    try
+    {
+        for(size_t buffer_size = 7; buffer_size <= 70000; buffer_size *= 100)
+        {
+            for(size_t queue_depth = 1; queue_depth <= 8; queue_depth *= 2)
+            {
+                std::cout << "Buffer size: " << buffer_size << " queue depth: " << queue_depth << std::endl;
+                nw::async_filebuf_options options;
+                options.buffer_size = buffer_size;
+                options.queue_depth = queue_depth;
+                test_write(exampleFilename, options);
+                test_read(exampleFilename, options);
+            }
+        }
+        std::cout << "Open modes" << std::endl;
+        test_open_modes(exampleFilename);
+    } catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,111 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "file_helpers.hpp"
+#include "test.hpp"
+#include <nowide/batch_writer.hpp>
+#include <nowide/cstdio.hpp>
+#include <nowide/fstream.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace nw = nowide;
+
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+void test_batch(const std::string& prefix)
+{
+    const size_t num_files = 20;
+    std::vector<nw::ofstream*> files;
+    std::vector<std::string> expected(num_files);
+    for(size_t i = 0; i < num_files; i++)
+    {
+        files.push_back(new nw::ofstream(make_filename(prefix, i).c_str(), std::ios::binary));
+        TEST(*files.back());
+    }
+    {
+        nw::batch_writer batch;
+        for(size_t round = 0; round < 10; round++)
+        {
+            for(size_t i = 0; i < num_files; i++)
+            {
+                std::ostringstream line;
+                line << "File " << i << " line " << round << "\n";
+                TEST(batch.write(*files[i]->rdbuf(), line.str()));
+                expected[i] += line.str();
+                // Data written to the stream before is written first
+                if(i % 2 && round < 9)
+                {
+                    TEST(batch.flush());
+                    TEST(*files[i] << "Direct\n");
+                    expected[i] += "Direct\n";
+                }
+            }
+        }
+        TEST(batch.size() > 0);
+        TEST(batch.flush());
+        TEST(batch.size() == 0);
+        // Flushed on destruction
+        TEST(batch.write(*files[0]->rdbuf(), "Last"));
+        expected[0] += "Last";
+    }
+    for(size_t i = 0; i < num_files; i++)
+    {
+        TEST(*files[i] << "End");
+        expected[i] += "End";
+        delete files[i];
+        TEST(read_file(make_filename(prefix, i)) == expected[i]);
+        TEST(nw::remove(make_filename(prefix, i).c_str()) == 0);
+    }
+}
+
+void test_flush_on_limit(const std::string& prefix)
+{
+    const std::string filename = make_filename(prefix, 0);
+    nw::ofstream f(filename.c_str(), std::ios::binary);
+    TEST(f);
+    nw::batch_writer batch(100);
+    std::string expected;
+    for(size_t i = 0; i < 50; i++)
+    {
+        TEST(batch.write(*f.rdbuf(), "0123456789"));
+        expected += "0123456789";
+        TEST(batch.size() <= 100);
+    }
+    TEST(batch.size() > 0);
+    TEST(batch.flush());
+    f.close();
+    TEST(read_file(filename) == expected);
+    // Closed file
+    TEST(batch.write(*f.rdbuf(), "Foo"));
+    TEST(!batch.flush());
+    TEST(nw::remove(filename.c_str()) == 0);
+}
+#endif
+
+int main(int, char** argv)
+{
+    try
+    {
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+        const std::string prefix = argv[0];
+        std::cout << "Batch" << std::endl;
+        test_batch(prefix);
+        std::cout << "Flush on limit" << std::endl;
+        test_flush_on_limit(prefix);
+#else
+        (void)argv;
+#endif
+    } catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "file_helpers.hpp"
+#include "test.hpp"
+#include <nowide/cstdio.hpp>
+#include <nowide/filebuf_pool.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace nw = nowide;
+
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+void test_reuse(const std::string& prefix)
+{
+    nw::filebuf_pool pool;
+    TEST(pool.available() == 0);
+    nw::filebuf* first = NULL;
+    for(size_t i = 0; i < 10; i++)
+    {
+        const std::string filename = make_filename(prefix, i);
+        nw::filebuf* const buf = pool.open(filename.c_str(), std::ios_base::out | std::ios_base::binary);
+        TEST(buf);
+        // Always the same filebuf
+        if(i == 0)
+            first = buf;
+        else
+            TEST(buf == first);
+        std::ostream os(buf);
+        TEST(os << "File " << i);
+        TEST(pool.release(buf));
+        TEST(pool.available() == 1);
+        std::ostringstream expected;
+        expected << "File " << i;
+        TEST(read_file(filename) == expected.str());
+    }
+    for(size_t i = 0; i < 10; i++)
+    {
+        const std::string filename = make_filename(prefix, i);
+        nw::filebuf* const buf = pool.open(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+        TEST(buf);
+        std::istream is(buf);
+        std::string word;
+        size_t n;
+        TEST(is >> word >> n);
+        TEST(word == "File");
+        TEST(n == i);
+        TEST(pool.release(buf));
+        TEST(nw::remove(filename.c_str()) == 0);
+    }
+    // Failure gives the filebuf back
+    TEST(!pool.open((prefix + "-missing/file.txt").c_str(), std::ios_base::in));
+    TEST(pool.available() == 1);
+}
+
+void test_open_many(const std::string& prefix)
+{
+    const size_t num_files = 20;
+    std::vector<std::string> names;
+    for(size_t i = 0; i < num_files; i++)
+        names.push_back(make_filename(prefix, i));
+    // Fails as the directory does not exist
+    names[5] = prefix + "-missing/file.txt";
+    std::vector<const char*> c_names;
+    for(size_t i = 0; i < num_files; i++)
+        c_names.push_back(names[i].c_str());
+
+    nw::filebuf_pool pool;
+    std::vector<nw::filebuf*> files(num_files);
+    TEST(pool.open_many(&c_names[0], num_files, std::ios_base::out | std::ios_base::binary, &files[0])
+         == num_files - 1);
+    // The filebuf of the failed file was used for the next one
+    TEST(pool.available() == 0);
+    for(size_t i = 0; i < num_files; i++)
+    {
+        if(i == 5)
+        {
+            TEST(!files[i]);
+            continue;
+        }
+        TEST(files[i]);
+        TEST(files[i]->sputn(names[i].c_str(), names[i].size()) == std::streamsize(names[i].size()));
+        TEST(pool.release(files[i]));
+    }
+    TEST(pool.available() == num_files - 1);
+    // All filebufs are reused
+    TEST(pool.open_many(&c_names[0], num_files, std::ios_base::in | std::ios_base::binary, &files[0])
+         == num_files - 1);
+    TEST(pool.available() == 0);
+    for(size_t i = 0; i < num_files; i++)
+    {
+        if(i == 5)
+            continue;
+        std::string content(names[i].size(), '\0');
+        TEST(files[i]->sgetn(&content[0], content.size()) == std::streamsize(content.size()));
+        TEST(content == names[i]);
+        TEST(pool.release(files[i]));
+        TEST(nw::remove(names[i].c_str()) == 0);
+    }
+}
+#endif
+
+int main(int, char** argv)
+{
+    try
+    {
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+        const std::string prefix = argv[0];
+        std::cout << "Reuse" << std::endl;
+        test_reuse(prefix);
+        std::cout << "Open many" << std::endl;
+        test_open_many(prefix);
+#else
+        (void)argv;
+#endif
+    } catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Ok" << std::endl;
+    return 0;
+}
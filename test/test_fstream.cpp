@@ -7,12 +7,18 @@
 //  http://www.boost.org/LICENSE_1_0.txt)
 //
 
+#include "file_helpers.hpp"
 #include "test.hpp"
 #include <nowide/convert.hpp>
 #include <nowide/cstdio.hpp>
 #include <nowide/fstream.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 namespace nw = nowide;
 
@@ -50,6 +56,986 @@ bool file_contents_equal(const char* filepath, const char (&contents)[N], bool b
     return true;
 }
 
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+template<typename CharType>
+void test_utf8_filebuf(const char* filepath)
+{
+    typedef std::basic_string<CharType> wstring;
+    typedef std::char_traits<CharType> traits;
+    // ASCII, 2, 3 and 4 (surrogate pair in UTF-16) byte sequences
+    const std::string utf8 = "a\xd7\xa9\xe2\x82\xac\xf0\x9f\x98\x80\n";
+    const wstring wide = nw::detail::convert_string<CharType>(utf8.c_str(), utf8.c_str() + utf8.size());
+    const int repeats = 100;
+    std::string expected_utf8;
+    wstring expected_wide;
+    for(int i = 0; i < repeats; i++)
+    {
+        expected_utf8 += utf8;
+        expected_wide += wide;
+    }
+    // 0 = default buffer
+    for(int buf_size = 0; buf_size < 8; buf_size++)
+    {
+        {
+            nw::basic_ofstream<CharType> fo;
+            if(buf_size)
+                fo.rdbuf()->pubsetbuf(NULL, buf_size);
+            fo.open(filepath, std::ios::binary);
+            TEST(fo);
+            for(int i = 0; i < repeats; i++)
+                TEST(fo.write(wide.c_str(), wide.size()));
+        }
+        TEST(read_file(filepath) == expected_utf8);
+
+        nw::basic_ifstream<CharType> fi;
+        if(buf_size)
+            fi.rdbuf()->pubsetbuf(NULL, buf_size);
+        fi.open(filepath, std::ios::binary);
+        TEST(fi);
+        wstring content(expected_wide.size(), CharType(0));
+        TEST(fi.read(&content[0], content.size()));
+        TEST(content == expected_wide);
+        TEST(fi.get() == traits::eof());
+
+        // Positions are byte positions
+        fi.clear();
+        TEST(fi.seekg(0));
+        TEST(fi.get() == CharType('a'));
+        const std::streampos pos = fi.tellg();
+        TEST(pos == std::streampos(1));
+        TEST(fi.get() == traits::to_int_type(wide[1]));
+        TEST(fi.get() == traits::to_int_type(wide[2]));
+        TEST(fi.seekg(pos));
+        TEST(fi.get() == traits::to_int_type(wide[1]));
+        TEST(fi.seekg(0, std::ios_base::end));
+        TEST(fi.tellg() == std::streampos(expected_utf8.size()));
+        // Relative seeks are not supported
+        TEST(!fi.seekg(1, std::ios_base::cur));
+    }
+    // Invalid and trailing incomplete sequences are replaced
+    {
+        nw::ofstream fo(filepath, std::ios::binary);
+        TEST(fo << "a\xff" << "b\xe2\x82");
+    }
+    {
+        nw::basic_ifstream<CharType> fi(filepath, std::ios::binary);
+        wstring content(5, CharType(0));
+        TEST(fi.read(&content[0], 4));
+        content.resize(4);
+        const CharType replacement = CharType(NOWIDE_REPLACEMENT_CHARACTER);
+        TEST(content[0] == CharType('a'));
+        TEST(content[1] == replacement);
+        TEST(content[2] == CharType('b'));
+        TEST(content[3] == replacement);
+        TEST(fi.get() == traits::eof());
+    }
+    // Read-modify-write
+    {
+        nw::basic_fstream<CharType> f(filepath, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+        TEST(f.write(wide.c_str(), wide.size()));
+        TEST(f.seekg(0));
+        TEST(f.get() == CharType('a'));
+        TEST(f.put(CharType('b')));
+        TEST(f.seekg(0, std::ios_base::beg));
+        TEST(f.get() == CharType('a'));
+        TEST(f.get() == CharType('b'));
+        // Overwrote the lead byte of the 2nd character
+        TEST(f.get() == CharType(NOWIDE_REPLACEMENT_CHARACTER));
+    }
+    TEST(read_file(filepath) == "ab\xa9\xe2\x82\xac\xf0\x9f\x98\x80\n");
+    TEST(nw::remove(filepath) == 0);
+}
+
+// Exposes the buffer areas of the filebuf
+class test_filebuf : public nw::filebuf
+{
+public:
+    std::ptrdiff_t get_area_size() const
+    {
+        return egptr() - eback();
+    }
+    std::ptrdiff_t put_area_size() const
+    {
+        return epptr() - pbase();
+    }
+    const char* put_area_begin() const
+    {
+        return pbase();
+    }
+    std::ptrdiff_t putback_area_size() const
+    {
+        return gptr() - eback();
+    }
+};
+
+void test_buffer_size_options(const char* filepath)
+{
+    const std::string data = make_test_data(1000);
+    nw::filebuf_options options;
+    options.buffer_size = 4;
+    options.max_buffer_size = 64;
+    {
+        test_filebuf buf;
+        TEST(buf.open(filepath, std::ios::out | std::ios::binary, options) == &buf);
+        TEST(buf.sputc(data[0]) == data[0]);
+        TEST(buf.put_area_size() == 4);
+        for(size_t i = 1; i < data.size(); i++)
+            TEST(buf.sputc(data[i]) == data[i]);
+        // Grown on sequential writes but not beyond the maximum
+        TEST(buf.put_area_size() == 64);
+        TEST(buf.close() == &buf);
+    }
+    TEST(read_file(filepath) == data);
+    {
+        test_filebuf buf;
+        TEST(buf.open(filepath, std::ios::in | std::ios::binary, options) == &buf);
+        TEST(buf.sgetc() == data[0]);
+        TEST(buf.get_area_size() == 4);
+        for(size_t i = 0; i < 500; i++)
+            TEST(buf.sbumpc() == data[i]);
+        TEST(buf.get_area_size() == 64);
+        for(size_t i = 500; i < data.size(); i++)
+            TEST(buf.sbumpc() == data[i]);
+        TEST(buf.sgetc() == EOF);
+    }
+    // Random access keeps the small buffer
+    {
+        test_filebuf buf;
+        TEST(buf.open(filepath, std::ios::in | std::ios::binary, options) == &buf);
+        for(int i = 0; i < 10; i++)
+        {
+            TEST(buf.pubseekpos(i * 50) == std::streampos(i * 50));
+            TEST(buf.sgetc() == data[i * 50]);
+            TEST(buf.get_area_size() == 4);
+        }
+    }
+    // Options without an adaptive size
+    {
+        nw::filebuf_options fixed_options;
+        fixed_options.buffer_size = 16;
+        nw::ifstream f;
+        f.open(filepath, std::ios::binary, fixed_options);
+        TEST(f);
+        std::string content;
+        TEST(f >> content);
+        TEST(content == data);
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_single_buffer(const char* filepath)
+{
+    const std::string data = make_test_data(10000);
+    nw::filebuf_options options;
+    options.single_buffer = true;
+    for(size_t buf_size = 0; buf_size <= 64; buf_size += 16)
+    {
+        options.buffer_size = buf_size;
+        {
+            nw::ofstream f;
+            f.open(filepath, std::ios::binary, options);
+            TEST(f);
+            for(size_t i = 0; i < data.size(); i += 100)
+                TEST(f.write(&data[i], 100));
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nw::fstream f;
+            f.open(filepath, std::ios::in | std::ios::out | std::ios::binary, options);
+            TEST(f);
+            std::string content(data.size(), '\0');
+            TEST(f.read(&content[0], 5000));
+            TEST(f.put('X'));
+            TEST(f.seekg(4999));
+            TEST(f.get() == data[4999]);
+            TEST(f.get() == 'X');
+            TEST(f.read(&content[5001], data.size() - 5001));
+            TEST(content.compare(5001, std::string::npos, data, 5001, std::string::npos) == 0);
+        }
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_direct_io(const char* filepath)
+{
+    const std::string data = make_test_data(50000);
+    nw::filebuf_options options;
+    options.direct_io = true;
+    options.buffer_size = 5000;
+    for(int write_behind = 0; write_behind < 2; write_behind++)
+    {
+        options.write_behind = write_behind != 0;
+        {
+            nw::ofstream f;
+            f.open(filepath, std::ios::binary, options);
+            TEST(f);
+            for(size_t i = 0; i < data.size(); i += 100)
+                TEST(f.write(&data[i], 100));
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nw::ifstream f;
+            f.open(filepath, std::ios::binary, options);
+            TEST(f);
+            std::string content(data.size(), '\0');
+            TEST(f.read(&content[0], 10));
+            TEST(f.read(&content[10], data.size() - 10));
+            TEST(content == data);
+            TEST(f.get() == EOF);
+            f.clear();
+            // Unaligned positions
+            TEST(f.seekg(5001));
+            TEST(f.get() == data[5001]);
+            TEST(f.seekg(-3, std::ios::end));
+            TEST(f.read(&content[0], 3));
+            TEST(content.compare(0, 3, data, data.size() - 3, 3) == 0);
+            TEST(f.seekg(60000));
+            TEST(f.get() == EOF);
+        }
+        {
+            nw::fstream f;
+            f.open(filepath, std::ios::in | std::ios::out | std::ios::binary, options);
+            TEST(f);
+            TEST(f.seekp(4095));
+            TEST(f.write("XYZ", 3));
+            TEST(f.seekg(4094));
+            TEST(f.get() == data[4094]);
+            TEST(f.get() == 'X');
+            TEST(f.get() == 'Y');
+            TEST(f.get() == 'Z');
+            TEST(f.get() == data[4098]);
+        }
+        std::string expected = data;
+        expected.replace(4095, 3, "XYZ");
+        TEST(read_file(filepath) == expected);
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_preallocate(const char* filepath)
+{
+    const std::string data = make_test_data(100000);
+    nw::filebuf_options options;
+    options.preallocate = 200000;
+    {
+        nw::ofstream f;
+        f.open(filepath, std::ios::binary, options);
+        TEST(f);
+        TEST(f << data);
+    }
+    // Size is not changed
+    TEST(read_file(filepath) == data);
+    {
+        nw::fstream f(filepath, std::ios::in | std::ios::out | std::ios::binary);
+        TEST(f.seekg(8000));
+        TEST(f.get() == data[8000]);
+        TEST(!f.rdbuf()->punch_hole(-1, 10));
+        TEST(!f.rdbuf()->punch_hole(0, 0));
+        // Block aligned so the file system really deallocates it
+        if(f.rdbuf()->punch_hole(8192, 8192))
+        {
+            std::string expected = data;
+            expected.replace(8192, 8192, 8192, '\0');
+            TEST(f.seekg(8000));
+            std::string content(data.size() - 8000, '\0');
+            TEST(f.read(&content[0], content.size()));
+            TEST(content == expected.substr(8000));
+            f.close();
+            TEST(read_file(filepath) == expected);
+        } else
+        {
+#ifdef __linux__
+            std::cout << "Punching holes not supported by the file system" << std::endl;
+#endif
+        }
+    }
+    {
+        nw::ifstream f(filepath, std::ios::binary);
+        TEST(!f.rdbuf()->punch_hole(0, 10));
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_unlocked(const char* filepath)
+{
+    const std::string data = make_test_data(1000);
+    nw::filebuf_options options;
+    options.unlocked = true;
+    for(size_t buf_size = 0; buf_size <= 100; buf_size += 100)
+    {
+        {
+            nw::ofstream f;
+            if(buf_size == 0)
+                f.rdbuf()->pubsetbuf(NULL, 0);
+            else
+                options.buffer_size = buf_size;
+            f.open(filepath, std::ios::binary, options);
+            TEST(f);
+            for(size_t i = 0; i < data.size(); i++)
+                TEST(f.put(data[i]));
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nw::fstream f;
+            if(buf_size == 0)
+                f.rdbuf()->pubsetbuf(NULL, 0);
+            f.open(filepath, std::ios::in | std::ios::out | std::ios::binary, options);
+            TEST(f);
+            for(size_t i = 0; i < 500; i++)
+                TEST(f.get() == data[i]);
+            TEST(f.put('X'));
+            TEST(f.seekg(499));
+            TEST(f.get() == data[499]);
+            TEST(f.get() == 'X');
+            std::string content(499, '\0');
+            TEST(f.read(&content[0], content.size()));
+            TEST(content == data.substr(501));
+            TEST(f.get() == EOF);
+        }
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_keep_buffer(const char* filepath)
+{
+    nw::filebuf_options options;
+    options.keep_buffer = true;
+    test_filebuf buf;
+    TEST(buf.open(filepath, std::ios::out | std::ios::binary, options) == &buf);
+    TEST(buf.sputc('a') == 'a');
+    const char* const buffer = buf.put_area_begin();
+    TEST(buffer);
+    TEST(buf.close() == &buf);
+    TEST(!buf.put_area_begin());
+    TEST(buf.open(filepath, std::ios::out | std::ios::app | std::ios::binary, options) == &buf);
+    TEST(buf.sputc('b') == 'b');
+    TEST(buf.put_area_begin() == buffer);
+    TEST(buf.close() == &buf);
+    TEST(read_file(filepath) == "ab");
+    // Without the option the buffer is freed
+    TEST(buf.open(filepath, std::ios::out | std::ios::binary) == &buf);
+    TEST(buf.sputc('c') == 'c');
+    TEST(buf.close() == &buf);
+    TEST(buf.open(filepath, std::ios::in | std::ios::binary) == &buf);
+    TEST(buf.sbumpc() == 'c');
+    TEST(buf.sbumpc() == EOF);
+    TEST(buf.close() == &buf);
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_zero_copy(const char* filepath, const nw::filebuf_options& options)
+{
+    const std::string data = make_test_data(10000);
+    nw::filebuf buf;
+    TEST(buf.open(filepath, std::ios::out | std::ios::binary, options) == &buf);
+    size_t size;
+    // Records of increasing size, also larger than the buffer
+    for(size_t pos = 0, record = 1; pos < data.size(); pos += record, record *= 2)
+    {
+        record = (std::min)(record, data.size() - pos);
+        char* const p = buf.acquire_write(record, size);
+        TEST(p);
+        TEST(size >= record);
+        std::memcpy(p, &data[pos], record);
+        buf.commit_write(record);
+    }
+    TEST(buf.sputc('!') == '!');
+    TEST(buf.acquire_write(0, size));
+    TEST(size > 0);
+    buf.commit_write(0);
+    TEST(buf.close() == &buf);
+    TEST(read_file(filepath) == data + "!");
+    // Reading from a write-only file fails
+    TEST(buf.open(filepath, std::ios::out | std::ios::app | std::ios::binary, options) == &buf);
+    TEST(!buf.acquire_read(1, size));
+    TEST(size == 0u);
+    TEST(buf.close() == &buf);
+
+    TEST(buf.open(filepath, std::ios::in | std::ios::binary, options) == &buf);
+    TEST(!buf.acquire_write(1, size));
+    TEST(buf.sbumpc() == data[0]);
+    std::string content(1, data[0]);
+    for(size_t record = 1; content.size() < data.size(); record *= 3)
+    {
+        const char* const p = buf.acquire_read(record, size);
+        TEST(p);
+        TEST(size >= (std::min)(record, data.size() - content.size()));
+        const size_t n = (std::min)(record / 2 + 1, data.size() - content.size());
+        content.append(p, n);
+        buf.commit_read(n);
+    }
+    TEST(content == data);
+    TEST(buf.acquire_read(1, size));
+    TEST(size == 1u);
+    TEST(buf.sbumpc() == '!');
+    TEST(!buf.acquire_read(1, size));
+    TEST(size == 0u);
+    // Mixed with seeks
+    TEST(buf.pubseekoff(-11, std::ios::end) == std::streampos(data.size() - 10));
+    const char* const p = buf.acquire_read(100, size);
+    TEST(p);
+    TEST(std::string(p, size) == data.substr(data.size() - 10) + "!");
+    buf.commit_read(5);
+    TEST(buf.pubseekoff(0, std::ios::cur) == std::streampos(data.size() - 5));
+    TEST(buf.sbumpc() == data[data.size() - 5]);
+    TEST(buf.close() == &buf);
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_sequential(const char* filepath)
+{
+    const std::string data = make_test_data(100000);
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << data);
+    }
+    nw::filebuf_options options;
+    options.sequential = true;
+    options.buffer_size = 1000;
+    {
+        nw::ifstream f;
+        f.open(filepath, std::ios::binary, options);
+        TEST(f);
+        std::string content;
+        char c;
+        while(f.get(c))
+            content += c;
+        TEST(content == data);
+    }
+    {
+        nw::ifstream f;
+        f.open(filepath, std::ios::binary, options);
+        TEST(f);
+        std::string content(data.size(), '\0');
+        TEST(f.read(&content[0], 10));
+        TEST(f.read(&content[10], 50000));
+        TEST(f.read(&content[50010], data.size() - 50010));
+        TEST(content == data);
+        TEST(f.seekg(42));
+        TEST(f.get() == data[42]);
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_write_behind(const char* filepath)
+{
+    const std::string data = make_test_data(100000);
+    nw::filebuf_options options;
+    options.write_behind = true;
+    for(size_t buf_size = 0; buf_size <= 1024; buf_size += 256)
+    {
+        options.buffer_size = buf_size;
+        {
+            nw::ofstream f;
+            f.open(filepath, std::ios::binary, options);
+            TEST(f);
+            for(size_t i = 0; i < data.size(); i += 100)
+                TEST(f.write(&data[i], 100));
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nw::fstream f;
+            f.open(filepath, std::ios::in | std::ios::out | std::ios::binary, options);
+            TEST(f);
+            for(size_t i = 0; i < 5000; i++)
+                TEST(f.put('X'));
+            TEST(f.tellp() == std::streampos(5000));
+            TEST(f.get() == data[5000]);
+            TEST(f.seekp(10000));
+            TEST(f.write(&data[0], 20000));
+            TEST(f.seekg(4999));
+            TEST(f.get() == 'X');
+            TEST(f.get() == data[5000]);
+            TEST(f.seekg(10000));
+            std::string content(20000, '\0');
+            TEST(f.read(&content[0], content.size()));
+            TEST(content == data.substr(0, 20000));
+        }
+    }
+#ifdef __linux__
+    // Errors of background writes are reported
+    options.buffer_size = 64;
+    {
+        nw::ofstream f;
+        f.open("/dev/full", std::ios::binary, options);
+        TEST(f);
+        for(size_t i = 0; i < 10 && f; i++)
+            f.write(&data[0], 50);
+        TEST(!f.flush());
+    }
+#endif
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_seek_in_buffer(const char* filepath)
+{
+    const std::string data = make_test_data(1000);
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << data);
+    }
+    {
+        test_filebuf buf;
+        char buffer[64];
+        buf.pubsetbuf(buffer, sizeof(buffer));
+        TEST(buf.open(filepath, std::ios::in | std::ios::out | std::ios::binary) == &buf);
+        for(int i = 0; i < 100; i++)
+        {
+            TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(i));
+            TEST(buf.sbumpc() == data[i]);
+        }
+        // Seeks within the buffer keep it
+        TEST(buf.get_area_size() == 64);
+        TEST(buf.pubseekoff(-36, std::ios_base::cur) == std::streampos(64));
+        TEST(buf.get_area_size() == 64);
+        TEST(buf.sgetc() == data[64]);
+        // The buffer starts with the last 8 chars of the previous one
+        TEST(buf.pubseekpos(119) == std::streampos(119));
+        TEST(buf.get_area_size() == 64);
+        TEST(buf.sbumpc() == data[119]);
+        TEST(buf.pubseekpos(56) == std::streampos(56));
+        TEST(buf.get_area_size() == 64);
+        TEST(buf.sbumpc() == data[56]);
+        // Outside of the buffer
+        TEST(buf.pubseekpos(10) == std::streampos(10));
+        TEST(buf.sbumpc() == data[10]);
+        TEST(buf.pubseekoff(-10, std::ios_base::end) == std::streampos(990));
+        TEST(buf.sbumpc() == data[990]);
+        // Switch to writing after a seek within the buffer
+        TEST(buf.pubseekpos(500) == std::streampos(500));
+        TEST(buf.sgetc() == data[500]);
+        TEST(buf.pubseekpos(501) == std::streampos(501));
+        TEST(buf.sputc('X') == 'X');
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(502));
+        TEST(buf.sputc('Y') == 'Y');
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(503));
+        TEST(buf.pubseekpos(500) == std::streampos(500));
+        TEST(buf.sbumpc() == data[500]);
+        TEST(buf.sbumpc() == 'X');
+        TEST(buf.sbumpc() == 'Y');
+        TEST(buf.sbumpc() == data[503]);
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_putback_area(const char* filepath)
+{
+    const std::string data = make_test_data(1000);
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << data);
+    }
+    nw::filebuf_options options;
+    options.buffer_size = 32;
+    test_filebuf buf;
+    TEST(buf.open(filepath, std::ios::in | std::ios::binary, options) == &buf);
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        TEST(buf.sbumpc() == data[i]);
+        // The last 8 chars can always be put back without accessing the file
+        const size_t n = (std::min)(i + 1, size_t(8));
+        TEST(buf.putback_area_size() >= std::ptrdiff_t(n));
+        if(i % 7 == 0)
+        {
+            for(size_t j = 0; j < n; j++)
+                TEST(buf.sungetc() == data[i - j]);
+            for(size_t j = 0; j < n; j++)
+                TEST(buf.sbumpc() == data[i + 1 - n + j]);
+        }
+    }
+    TEST(buf.sbumpc() == EOF);
+    TEST(buf.putback_area_size() == 8);
+    TEST(buf.sungetc() == data[999]);
+    TEST(buf.sbumpc() == data[999]);
+    // Also after reading a large block directly
+    TEST(buf.pubseekpos(10) == std::streampos(10));
+    std::string block(100, '\0');
+    TEST(buf.sgetn(&block[0], 100) == 100);
+    TEST(block == data.substr(10, 100));
+    TEST(buf.putback_area_size() == 8);
+    TEST(buf.sungetc() == data[109]);
+    TEST(buf.sbumpc() == data[109]);
+    TEST(buf.sbumpc() == data[110]);
+    TEST(buf.close() == &buf);
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_positional_io(const char* filepath, const nw::filebuf_options& options)
+{
+    const std::string data = make_test_data(100000);
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << data);
+    }
+    nw::filebuf buf;
+    TEST(buf.open(filepath, std::ios::in | std::ios::binary, options) == &buf);
+    TEST(buf.sbumpc() == data[0]);
+    char c;
+#ifdef NOWIDE_WINDOWS
+    // Memory mapping is not supported either
+    TEST(buf.read_at(&c, 1, 0) == -1);
+#else
+    // Threads read disjoint regions of the same file
+    const size_t num_threads = 4, region_size = data.size() / num_threads;
+    std::vector<std::string> regions(num_threads, std::string(region_size, '\0'));
+    std::vector<std::streamsize> results(num_threads);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < num_threads; i++)
+    {
+        threads.push_back(std::thread([&, i]() {
+            for(size_t pos = 0; pos < region_size; pos += 1000)
+            {
+                const std::streamsize n = buf.read_at(&regions[i][pos], 1000, i * region_size + pos);
+                results[i] += (n < 0) ? -1000000 : n;
+            }
+        }));
+    }
+    for(size_t i = 0; i < num_threads; i++)
+        threads[i].join();
+    for(size_t i = 0; i < num_threads; i++)
+    {
+        TEST(results[i] == std::streamsize(region_size));
+        TEST(regions[i] == data.substr(i * region_size, region_size));
+    }
+    // At and after the end
+    TEST(buf.read_at(&regions[0][0], 100, data.size() - 10) == 10);
+    TEST(regions[0].substr(0, 10) == data.substr(data.size() - 10));
+    TEST(buf.read_at(&c, 1, data.size()) == 0);
+    TEST(buf.read_at(&c, 1, data.size() + 10) == 0);
+    TEST(buf.read_at(&c, 1, -1) == -1);
+    // Writing requires an output file
+    TEST(buf.write_at("x", 1, 0) == -1);
+#endif
+    // The stream position is unchanged
+    TEST(buf.pubseekoff(0, std::ios::cur) == std::streampos(1));
+    TEST(buf.sbumpc() == data[1]);
+    TEST(buf.close() == &buf);
+    TEST(buf.read_at(&c, 1, 0) == -1);
+    if(options.memory_map)
+        return;
+
+    TEST(buf.open(filepath, std::ios::in | std::ios::out | std::ios::binary, options) == &buf);
+    TEST(buf.sputn("Hello", 5) == 5);
+#ifdef NOWIDE_WINDOWS
+    TEST(buf.write_at("World", 5, 100) == -1);
+#else
+    TEST(buf.write_at("World", 5, 100) == 5);
+    TEST(buf.write_at("!", 1, data.size()) == 1);
+    TEST(buf.read_at(&c, 1, 101) == 1);
+    TEST(c == 'o');
+    // The written bytes are not in the buffer
+    TEST(buf.pubseekoff(0, std::ios::cur) == std::streampos(5));
+    TEST(buf.pubseekpos(100) == std::streampos(100));
+    TEST(buf.sbumpc() == 'W');
+#endif
+    TEST(buf.close() == &buf);
+    std::string expected = data;
+    expected.replace(0, 5, "Hello");
+#ifndef NOWIDE_WINDOWS
+    expected.replace(100, 5, "World");
+    expected += '!';
+#endif
+    TEST(read_file(filepath) == expected);
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_open_modes(const char* filepath)
+{
+    typedef std::ios_base base;
+    const base::openmode valid_modes[] = {base::out,
+                                          base::out | base::app,
+                                          base::app,
+                                          base::out | base::trunc,
+                                          base::in,
+                                          base::in | base::out,
+                                          base::in | base::out | base::trunc,
+                                          base::in | base::out | base::app,
+                                          base::in | base::app};
+    const base::openmode invalid_modes[] = {
+      base::trunc, base::in | base::trunc, base::app | base::trunc, base::in | base::out | base::app | base::trunc};
+    nw::filebuf buf;
+    for(int binary = 0; binary < 2; binary++)
+    {
+        const base::openmode extra = binary ? base::binary : base::openmode(0);
+        for(size_t i = 0; i < sizeof(valid_modes) / sizeof(valid_modes[0]); i++)
+        {
+            make_empty_file(filepath);
+            TEST(buf.open(filepath, valid_modes[i] | extra) == &buf);
+            TEST(buf.close() == &buf);
+            // With ate
+            TEST(buf.open(filepath, valid_modes[i] | extra | base::ate) == &buf);
+            TEST(buf.close() == &buf);
+        }
+        for(size_t i = 0; i < sizeof(invalid_modes) / sizeof(invalid_modes[0]); i++)
+        {
+            TEST(!buf.open(filepath, invalid_modes[i] | extra));
+            TEST(!buf.is_open());
+        }
+    }
+    // Wide file names
+    TEST(buf.open(nw::widen(filepath).c_str(), base::out | base::binary) == &buf);
+    TEST(buf.sputn("Hello", 5) == 5);
+    TEST(buf.close() == &buf);
+    TEST(read_file(filepath) == "Hello");
+    TEST(buf.open(nw::widen(filepath).c_str(), base::in | base::binary) == &buf);
+    TEST(buf.sbumpc() == 'H');
+    TEST(buf.close() == &buf);
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_memory_map(const char* filepath)
+{
+    const std::string data = make_test_data(10000);
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << data);
+    }
+    nw::filebuf_options options;
+    options.memory_map = true;
+    {
+        test_filebuf buf;
+        TEST(buf.open(filepath, std::ios::in | std::ios::binary, options) == &buf);
+        TEST(buf.sgetc() == data[0]);
+#ifndef NOWIDE_WINDOWS
+        TEST(buf.get_area_size() == static_cast<std::ptrdiff_t>(data.size()));
+#endif
+        // Not possible to write
+        TEST(buf.sputc('a') == EOF);
+    }
+    {
+        nw::ifstream f;
+        f.open(filepath, std::ios::binary, options);
+        TEST(f);
+        std::string content(data.size(), '\0');
+        TEST(f.read(&content[0], 100));
+        TEST(f.tellg() == std::streampos(100));
+        TEST(f.read(&content[100], data.size() - 100));
+        TEST(content == data);
+        TEST(f.get() == EOF);
+        f.clear();
+        TEST(f.seekg(-10, std::ios_base::end));
+        TEST(f.get() == data[data.size() - 10]);
+        TEST(f.seekg(5000));
+        TEST(f.get() == data[5000]);
+        TEST(f.seekg(-2, std::ios_base::cur));
+        TEST(f.get() == data[4999]);
+        // Putback of a different character
+        TEST(f.putback('X'));
+        TEST(f.get() == 'X');
+        TEST(f.seekg(0));
+        TEST(!f.unget());
+        f.clear();
+        TEST(f.get() == data[0]);
+    }
+    TEST(read_file(filepath) == data);
+    // At end
+    {
+        nw::ifstream f;
+        f.open(filepath, std::ios::binary | std::ios::ate, options);
+        TEST(f);
+        TEST(f.tellg() == std::streampos(data.size()));
+        TEST(f.get() == EOF);
+    }
+    // Ignored when writing
+    {
+        nw::fstream f;
+        f.open(filepath, std::ios::in | std::ios::out | std::ios::binary, options);
+        TEST(f);
+        TEST(f.get() == data[0]);
+        TEST(f.put('X'));
+        TEST(f.seekg(1));
+        TEST(f.get() == 'X');
+    }
+    // Empty files fall back to buffered reads
+    make_empty_file(filepath);
+    {
+        nw::ifstream f;
+        f.open(filepath, std::ios::binary, options);
+        TEST(f);
+        TEST(f.get() == EOF);
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+#endif
+
+void test_read_modify_write(const char* filepath)
+{
+    const size_t record_size = 10, num_records = 500;
+    std::string expected = make_test_data(record_size * num_records);
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << expected);
+    }
+    nw::fstream f(filepath, std::ios::in | std::ios::out | std::ios::binary);
+    TEST(f);
+    char record[record_size];
+    // Uppercase the first char of every record
+    for(size_t i = 0; i < num_records; i++)
+    {
+        TEST(f.read(record, record_size));
+        TEST(f.seekp(-static_cast<std::streamoff>(record_size), std::ios::cur));
+        TEST(f.tellp() == std::streampos(i * record_size));
+        TEST(f.put(static_cast<char>(record[0] - 'a' + 'A')));
+        TEST(f.seekg(record_size - 1, std::ios::cur));
+        expected[i * record_size] = static_cast<char>(expected[i * record_size] - 'a' + 'A');
+    }
+    TEST(f.get() == EOF);
+    f.clear();
+    // Read back records in reverse order
+    for(size_t i = num_records; i-- > 0;)
+    {
+        TEST(f.seekg(i * record_size));
+        TEST(f.read(record, record_size));
+        TEST(std::string(record, record_size) == expected.substr(i * record_size, record_size));
+    }
+    // Seek before the start fails and does not move the position
+    TEST(f.seekg(record_size));
+    TEST(!f.seekg(-static_cast<std::streamoff>(2 * record_size), std::ios::cur));
+    f.clear();
+    TEST(f.tellg() == std::streampos(record_size));
+    // Write after the end and at the start
+    TEST(f.seekp(5, std::ios::end));
+    TEST(f.write("end", 3));
+    TEST(f.seekp(0));
+    TEST(f.write("start", 5));
+    TEST(f.tellp() == std::streampos(5));
+    TEST(f.seekg(-3, std::ios::end));
+    TEST(f.read(record, 3));
+    TEST(std::string(record, 3) == "end");
+    f.close();
+    expected.replace(0, 5, "start");
+    expected += std::string(5, '\0') + "end";
+    TEST(read_file(filepath) == expected);
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_large_blocks(const char* filepath)
+{
+    const std::string data = make_test_data(100000);
+    for(int buf_size = -1; buf_size <= 16; buf_size += 4)
+    {
+        {
+            nw::ofstream f;
+            if(buf_size >= 0)
+                f.rdbuf()->pubsetbuf(NULL, buf_size);
+            f.open(filepath, std::ios::binary);
+            TEST(f.put(data[0]));
+            TEST(f.write(&data[1], 2));
+            TEST(f.write(&data[3], data.size() - 4));
+            TEST(f.put(data[data.size() - 1]));
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nw::fstream f;
+            if(buf_size >= 0)
+                f.rdbuf()->pubsetbuf(NULL, buf_size);
+            f.open(filepath, std::ios::in | std::ios::out | std::ios::binary);
+            std::string content(data.size(), '\0');
+            TEST(f.get() == data[0]);
+            TEST(f.read(&content[1], 2));
+            TEST(f.read(&content[3], 50000));
+            // Putback after a large read is implementation defined
+            // Boost.Nowide: Works
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+            TEST(f.unget());
+            TEST(f.get() == data[50002]);
+#endif
+            TEST(f.read(&content[50003], data.size() - 50003));
+            content[0] = data[0];
+            TEST(content == data);
+            TEST(f.get() == EOF);
+            f.clear();
+            // Large read followed by a write
+            TEST(f.seekg(0));
+            TEST(f.read(&content[0], 60000));
+            TEST(f.write("XYZ", 3));
+            TEST(f.seekg(59999));
+            TEST(f.read(&content[0], 5));
+            TEST(content.compare(0, 5, data[59999] + std::string("XYZ") + data[60003]) == 0);
+        }
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
+void test_copy_file_contents(const char* filepath)
+{
+    const std::string data = make_test_data(300000);
+    const std::string copy_path = std::string(filepath) + ".copy";
+    {
+        nw::ofstream f(filepath, std::ios::binary);
+        TEST(f << data);
+    }
+    {
+        nw::ifstream from(filepath, std::ios::binary);
+        nw::ofstream to(copy_path.c_str(), std::ios::binary);
+        TEST(from.get() == data[0]);
+        TEST(to << "Header");
+        TEST(nw::copy_file_contents(*from.rdbuf(), *to.rdbuf()) == std::streamsize(data.size() - 1));
+        TEST(from.get() == EOF);
+        TEST(to.tellp() == std::streampos(data.size() + 5));
+        TEST(to << "Footer");
+    }
+    TEST(read_file(copy_path.c_str()) == "Header" + data.substr(1) + "Footer");
+    // Append
+    {
+        nw::ifstream from(filepath, std::ios::binary);
+        nw::ofstream to(copy_path.c_str(), std::ios::binary | std::ios::app);
+        TEST(from.seekg(299990));
+        TEST(nw::copy_file_contents(*from.rdbuf(), *to.rdbuf()) == 10);
+    }
+    TEST(read_file(copy_path.c_str()) == "Header" + data.substr(1) + "Footer" + data.substr(299990));
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+    // From a mapped file
+    {
+        nw::filebuf_options options;
+        options.memory_map = true;
+        nw::ifstream from;
+        from.open(filepath, std::ios::binary, options);
+        nw::ofstream to(copy_path.c_str(), std::ios::binary);
+        TEST(from.seekg(100));
+        TEST(nw::copy_file_contents(*from.rdbuf(), *to.rdbuf()) == std::streamsize(data.size() - 100));
+        TEST(from.get() == EOF);
+    }
+    TEST(read_file(copy_path.c_str()) == data.substr(100));
+    // Wrong modes
+    {
+        nw::ofstream from(filepath, std::ios::binary | std::ios::app);
+        nw::ifstream to(copy_path.c_str(), std::ios::binary);
+        TEST(nw::copy_file_contents(*from.rdbuf(), *to.rdbuf()) == -1);
+    }
+#endif
+    TEST(nw::remove(filepath) == 0);
+    TEST(nw::remove(copy_path.c_str()) == 0);
+}
+
+void test_large_offsets(const char* filepath)
+{
+    // Beyond 4 GiB, the file is sparse on the usual filesystems
+    const std::streamoff offset = std::streamoff(5) << 30;
+    {
+        nw::fstream f(filepath, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+        TEST(f.write("abc", 3));
+        TEST(f.seekp(offset));
+        TEST(f.tellp() == std::streampos(offset));
+        TEST(f.write("xyz", 3));
+        TEST(f.tellp() == std::streampos(offset + 3));
+        TEST(f.seekg(0, std::ios::end));
+        TEST(f.tellg() == std::streampos(offset + 3));
+    }
+    {
+        nw::ifstream f(filepath, std::ios::binary);
+        char buf[4] = {};
+        TEST(f.seekg(offset + 1));
+        TEST(f.read(buf, 2));
+        TEST(std::string(buf) == "yz");
+        TEST(f.tellg() == std::streampos(offset + 3));
+        TEST(f.seekg(-(offset + 3), std::ios::cur));
+        TEST(f.read(buf, 3));
+        TEST(std::string(buf) == "abc");
+    }
+    TEST(nw::remove(filepath) == 0);
+}
+
 void test_with_different_buffer_sizes(const char* filepath)
 {
     /* Important part of the standard for mixing input with output:
@@ -195,6 +1181,44 @@ void test_flush(const char* filepath)
     }
 }
 
+template<typename OFStream>
+void test_tellp_append(const char* filepath)
+{
+    {
+        OFStream fo(filepath, std::ios_base::out | std::ios::trunc | std::ios::binary);
+        TEST(fo << "0123456789");
+    }
+    {
+        OFStream fo(filepath, std::ios_base::app | std::ios::binary);
+        TEST(fo);
+        TEST(fo.tellp() == std::streampos(10));
+        TEST(fo.write("AB", 2));
+        TEST(fo.tellp() == std::streampos(12));
+        TEST(fo.flush());
+        TEST(fo.tellp() == std::streampos(12));
+    }
+    TEST(read_file(filepath) == "0123456789AB");
+}
+
+template<typename OFStream>
+void test_flush_after_seek(const char* filepath)
+{
+    OFStream fo(filepath, std::ios_base::out | std::ios::trunc | std::ios::binary);
+    TEST(fo);
+    const std::string data = "0123456789abcdefghij";
+    TEST(fo.write(data.data(), 10));
+    TEST(fo.seekp(5));
+    TEST(fo.write(data.data() + 5, 15));
+    // Seeking writes the buffered data, flushing must still pass it to the file
+    TEST(fo.seekp(2));
+    TEST(fo.flush());
+    TEST(read_file(filepath) == data);
+    TEST(fo.write("xy", 2));
+    TEST(fo.seekp(0, std::ios_base::end));
+    TEST(fo.flush());
+    TEST(read_file(filepath) == "01xy456789abcdefghij");
+}
+
 void test_ofstream_creates_file(const char* filename)
 {
     nw::remove(filename);
@@ -506,6 +1530,23 @@ int main(int, char** argv)
         std::cout << "Complex IO" << std::endl;
         test_with_different_buffer_sizes(exampleFilename.c_str());
 
+        std::cout << "Read-modify-write" << std::endl;
+        test_read_modify_write(exampleFilename.c_str());
+        std::cout << "Large blocks" << std::endl;
+        test_large_blocks(exampleFilename.c_str());
+
+        std::cout << "Copy file contents" << std::endl;
+        test_copy_file_contents(exampleFilename.c_str());
+
+        // Needs 5 GiB on file systems without sparse files, Linux file systems usually have them
+#ifndef __linux__
+        if(std::getenv("NOWIDE_TEST_LARGE_FILES"))
+#endif
+        {
+            std::cout << "Large offsets" << std::endl;
+            test_large_offsets(exampleFilename.c_str());
+        }
+
         std::cout << "filebuf::close" << std::endl;
         test_close(exampleFilename.c_str());
 
@@ -513,6 +1554,62 @@ int main(int, char** argv)
         test_flush<std::ifstream, std::ofstream>(exampleFilename.c_str());
         std::cout << "Flush - Test" << std::endl;
         test_flush<nw::ifstream, nw::ofstream>(exampleFilename.c_str());
+        test_tellp_append<std::ofstream>(exampleFilename.c_str());
+        test_tellp_append<nw::ofstream>(exampleFilename.c_str());
+        test_flush_after_seek<std::ofstream>(exampleFilename.c_str());
+        test_flush_after_seek<nw::ofstream>(exampleFilename.c_str());
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+        std::cout << "UTF-8 filebuf" << std::endl;
+        test_utf8_filebuf<wchar_t>(exampleFilename.c_str());
+        test_utf8_filebuf<char16_t>(exampleFilename.c_str());
+        test_utf8_filebuf<char32_t>(exampleFilename.c_str());
+        std::cout << "Buffer size options" << std::endl;
+        test_buffer_size_options(exampleFilename.c_str());
+        std::cout << "Single buffer" << std::endl;
+        test_single_buffer(exampleFilename.c_str());
+        std::cout << "Direct I/O" << std::endl;
+        test_direct_io(exampleFilename.c_str());
+        std::cout << "Preallocate" << std::endl;
+        test_preallocate(exampleFilename.c_str());
+        std::cout << "Unlocked" << std::endl;
+        test_unlocked(exampleFilename.c_str());
+        std::cout << "Keep buffer" << std::endl;
+        test_keep_buffer(exampleFilename.c_str());
+        std::cout << "Zero copy" << std::endl;
+        for(size_t buffer_size = 1; buffer_size <= 10000; buffer_size *= 100)
+        {
+            nw::filebuf_options options;
+            options.buffer_size = buffer_size;
+            test_zero_copy(exampleFilename.c_str(), options);
+            options.write_behind = true;
+            options.direct_io = true;
+            test_zero_copy(exampleFilename.c_str(), options);
+        }
+        {
+            nw::filebuf_options options;
+            options.memory_map = true;
+            test_zero_copy(exampleFilename.c_str(), options);
+        }
+        std::cout << "Sequential" << std::endl;
+        test_sequential(exampleFilename.c_str());
+        std::cout << "Write behind" << std::endl;
+        test_write_behind(exampleFilename.c_str());
+        std::cout << "Seek in buffer" << std::endl;
+        test_seek_in_buffer(exampleFilename.c_str());
+        std::cout << "Putback area" << std::endl;
+        test_putback_area(exampleFilename.c_str());
+        std::cout << "Open modes" << std::endl;
+        test_open_modes(exampleFilename.c_str());
+        std::cout << "Positional I/O" << std::endl;
+        {
+            nw::filebuf_options options;
+            test_positional_io(exampleFilename.c_str(), options);
+            options.memory_map = true;
+            test_positional_io(exampleFilename.c_str(), options);
+        }
+        std::cout << "Memory map" << std::endl;
+        test_memory_map(exampleFilename.c_str());
+#endif
     } catch(const std::exception& e)
     {
         std::cerr << e.what() << std::endl;
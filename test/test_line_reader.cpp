@@ -0,0 +1,125 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "file_helpers.hpp"
+#include "test.hpp"
+#include <nowide/cstdio.hpp>
+#include <nowide/line_reader.hpp>
+#include <iostream>
+#include <vector>
+
+namespace nw = nowide;
+
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+std::vector<std::string> read_lines(const std::string& filepath, const nw::filebuf_options& options)
+{
+    nw::filebuf buf;
+    TEST(buf.open(filepath.c_str(), std::ios_base::in | std::ios_base::binary, options));
+    nw::line_reader reader(buf);
+    std::vector<std::string> lines;
+    const char* data;
+    size_t size;
+    while(reader.next(data, size))
+        lines.push_back(std::string(data, size));
+    // Stays at the end
+    TEST(!reader.next(data, size));
+    return lines;
+}
+
+void test_lines(const std::string& filepath, const nw::filebuf_options& options)
+{
+    std::string long_line(1000, 'x');
+    for(size_t i = 0; i < long_line.size(); i++)
+        long_line[i] = static_cast<char>('a' + i % 26);
+    const char* const contents[] = {"", "\n", "a", "a\n", "\n\nb\n\n", "a\r\nb", "Hello\nWorld\n"};
+    for(size_t i = 0; i < sizeof(contents) / sizeof(contents[0]); i++)
+    {
+        create_file(filepath, contents[i]);
+        const std::vector<std::string> lines = read_lines(filepath, options);
+        std::vector<std::string> expected;
+        std::string content = contents[i];
+        size_t pos;
+        while((pos = content.find('\n')) != std::string::npos)
+        {
+            expected.push_back(content.substr(0, pos));
+            content.erase(0, pos + 1);
+        }
+        if(!content.empty())
+            expected.push_back(content);
+        TEST(lines == expected);
+    }
+    // Lines spanning multiple buffers
+    create_file(filepath, "short\n" + long_line + "\n\n" + long_line);
+    std::vector<std::string> lines = read_lines(filepath, options);
+    TEST(lines.size() == 4u);
+    TEST(lines[0] == "short");
+    TEST(lines[1] == long_line);
+    TEST(lines[2].empty());
+    TEST(lines[3] == long_line);
+    TEST(nw::remove(filepath.c_str()) == 0);
+}
+
+void test_mixed_use(const std::string& filepath)
+{
+    create_file(filepath, "first\nsecond\nthird\nfourth\n");
+    nw::filebuf buf;
+    TEST(buf.open(filepath.c_str(), std::ios_base::in | std::ios_base::binary));
+    nw::line_reader reader(buf);
+    std::string line;
+    TEST(reader.next(line));
+    TEST(line == "first");
+    // Continues after the line
+    TEST(buf.sbumpc() == 's');
+    TEST(reader.next(line));
+    TEST(line == "econd");
+    TEST(buf.pubseekoff(-7, std::ios_base::cur) == std::streampos(6));
+    TEST(reader.next(line));
+    TEST(line == "second");
+    std::istream is(&buf);
+    TEST(std::getline(is, line));
+    TEST(line == "third");
+    TEST(reader.next(line));
+    TEST(line == "fourth");
+    TEST(!reader.next(line));
+    TEST(line == "fourth");
+    buf.close();
+    TEST(nw::remove(filepath.c_str()) == 0);
+}
+#endif
+
+int main(int, char** argv)
+{
+    try
+    {
+#if NOWIDE_USE_FILEBUF_REPLACEMENT
+        const std::string exampleFilename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+        const size_t buffer_sizes[] = {1, 7, 4096};
+        for(size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++)
+        {
+            std::cout << "Buffer size: " << buffer_sizes[i] << std::endl;
+            nw::filebuf_options options;
+            options.buffer_size = buffer_sizes[i];
+            test_lines(exampleFilename, options);
+        }
+        std::cout << "Memory mapped" << std::endl;
+        nw::filebuf_options options;
+        options.memory_map = true;
+        test_lines(exampleFilename, options);
+        std::cout << "Mixed use" << std::endl;
+        test_mixed_use(exampleFilename);
+#else
+        (void)argv;
+#endif
+    } catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,180 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "file_helpers.hpp"
+#include "test.hpp"
+#include <nowide/cstdio.hpp>
+#include <nowide/parallel_file_reader.hpp>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace nw = nowide;
+
+std::string make_lines(size_t num_lines)
+{
+    std::string result;
+    for(size_t i = 0; i < num_lines; i++)
+    {
+        // Some lines are longer than the smaller buffers
+        const size_t length = (i % 10 == 0) ? 100 : i % 7;
+        for(size_t j = 0; j < length; j++)
+            result += static_cast<char>('a' + (i + j) % 26);
+        result += '\n';
+    }
+    return result;
+}
+
+void test_read(const std::string& filepath, const std::string& data, const nw::parallel_file_reader_options& options)
+{
+    nw::parallel_file_reader reader(filepath.c_str(), options);
+    TEST(reader.is_open());
+    const std::vector<std::streamoff> bounds = reader.boundaries();
+    TEST(bounds.size() == options.num_ranges + 1);
+    TEST(bounds.front() == 0);
+    TEST(bounds.back() == std::streamoff(data.size()));
+    for(size_t i = 1; i < bounds.size(); i++)
+    {
+        TEST(bounds[i - 1] <= bounds[i]);
+        if(options.delimiter != EOF && bounds[i] > 0 && bounds[i] < std::streamoff(data.size()))
+            TEST(data[static_cast<size_t>(bounds[i] - 1)] == options.delimiter);
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> ranges(options.num_ranges);
+    bool chunks_ok = true;
+    TEST(reader.read([&](size_t range, const char* chunk, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(range >= ranges.size() || size == 0)
+        {
+            chunks_ok = false;
+            return;
+        }
+        ranges[range].append(chunk, size);
+        // Only whole records
+        const std::streamoff end = bounds[range] + std::streamoff(ranges[range].size());
+        if(options.delimiter != EOF && end < std::streamoff(data.size()) && chunk[size - 1] != options.delimiter)
+            chunks_ok = false;
+    }));
+    TEST(chunks_ok);
+    std::string content;
+    for(size_t i = 0; i < ranges.size(); i++)
+    {
+        TEST(ranges[i] == data.substr(static_cast<size_t>(bounds[i]), static_cast<size_t>(bounds[i + 1] - bounds[i])));
+        content += ranges[i];
+    }
+    TEST(content == data);
+    TEST(reader.close());
+    TEST(!reader.is_open());
+}
+
+void test_nested(const std::string& filepath, const std::string& data)
+{
+    nw::parallel_file_reader_options options;
+    options.num_ranges = 16;
+    options.buffer_size = 1024;
+    nw::parallel_file_reader reader(filepath.c_str(), options);
+    std::mutex mutex;
+    size_t total = 0;
+    // Handlers may block on further reads
+    TEST(reader.read([&](size_t, const char*, size_t) {
+        nw::parallel_file_reader nested(filepath.c_str(), options);
+        size_t size = 0;
+        nested.read([&](size_t, const char*, size_t n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            size += n;
+        });
+        std::lock_guard<std::mutex> lock(mutex);
+        total += size;
+    }));
+    TEST(total % data.size() == 0u);
+    TEST(total > 0u);
+}
+
+void test_errors(const std::string& filepath)
+{
+    create_file(filepath, make_lines(1000));
+    nw::parallel_file_reader_options options;
+    options.num_ranges = 4;
+    options.buffer_size = 100;
+    {
+        nw::parallel_file_reader reader(options);
+        TEST(!reader.is_open());
+        TEST(!reader.read([](size_t, const char*, size_t) {}));
+        TEST(!reader.open(filepath + ".missing"));
+        TEST(reader.open(filepath));
+        // Exceptions of the handler are passed on
+        bool caught = false;
+        try
+        {
+            reader.read([](size_t range, const char*, size_t) {
+                if(range == 2)
+                    throw std::runtime_error("Range 2");
+            });
+        } catch(const std::runtime_error& e)
+        {
+            caught = std::string(e.what()) == "Range 2";
+        }
+        TEST(caught);
+        // Still usable
+        TEST(reader.read([](size_t, const char*, size_t) {}));
+    }
+    // Empty file
+    create_file(filepath, "");
+    {
+        nw::parallel_file_reader reader(filepath.c_str(), options);
+        bool called = false;
+        TEST(reader.read([&](size_t, const char*, size_t) { called = true; }));
+        TEST(!called);
+    }
+    TEST(nw::remove(filepath.c_str()) == 0);
+}
+
+int main(int, char** argv)
+{
+    const std::string exampleFilename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    try
+    {
+        const std::string data = make_lines(10000);
+        create_file(exampleFilename, data);
+        const size_t num_ranges[] = {1, 3, 16};
+        const size_t buffer_sizes[] = {5, 64, 1024 * 1024};
+        for(size_t i = 0; i < sizeof(num_ranges) / sizeof(num_ranges[0]); i++)
+        {
+            for(size_t j = 0; j < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); j++)
+            {
+                std::cout << "Ranges: " << num_ranges[i] << " buffer size: " << buffer_sizes[j] << std::endl;
+                nw::parallel_file_reader_options options;
+                options.num_ranges = num_ranges[i];
+                options.buffer_size = buffer_sizes[j];
+                test_read(exampleFilename, data, options);
+                options.delimiter = '\n';
+                test_read(exampleFilename, data, options);
+            }
+        }
+        std::cout << "Nested reads" << std::endl;
+        test_nested(exampleFilename, data);
+        std::cout << "More ranges than bytes" << std::endl;
+        create_file(exampleFilename, "a\nb");
+        nw::parallel_file_reader_options options;
+        options.num_ranges = 10;
+        test_read(exampleFilename, "a\nb", options);
+        options.delimiter = '\n';
+        test_read(exampleFilename, "a\nb", options);
+        TEST(nw::remove(exampleFilename.c_str()) == 0);
+        std::cout << "Errors" << std::endl;
+        test_errors(exampleFilename);
+    } catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,138 @@
+//
+//  Copyright (c) 2026 agent
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "file_helpers.hpp"
+#include "test.hpp"
+#include <nowide/cstdio.hpp>
+#include <nowide/parallel_file_writer.hpp>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace nw = nowide;
+
+void test_write(const std::string& prefix, const nw::parallel_file_writer_options& options)
+{
+    const size_t num_files = 8, num_threads = 4, num_records = 2000;
+    std::vector<std::string> names;
+    nw::parallel_file_writer files(options);
+    for(size_t i = 0; i < num_files; i++)
+    {
+        names.push_back(make_filename(prefix, i));
+        TEST(files.open(names.back()));
+    }
+    TEST(files.num_files() == num_files);
+
+    std::vector<int> results(num_threads, 1);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < num_threads; t++)
+    {
+        threads.push_back(std::thread([&files, &results, t]() {
+            nw::parallel_file_writer::writer writer(files);
+            for(size_t i = 0; i < num_records; i++)
+            {
+                std::ostringstream record;
+                record << t << ' ' << i << '\n';
+                if(!writer.write(i % num_files, record.str()))
+                    results[t] = 0;
+            }
+        }));
+    }
+    for(size_t t = 0; t < num_threads; t++)
+    {
+        threads[t].join();
+        TEST(results[t]);
+    }
+    TEST(files.flush());
+
+    // Records of each thread are complete and in order
+    for(size_t i = 0; i < num_files; i++)
+    {
+        std::istringstream content(read_file(names[i]));
+        std::vector<size_t> next(num_threads);
+        for(size_t j = 0; j < num_threads; j++)
+            next[j] = i;
+        size_t t, record;
+        while(content >> t >> record)
+        {
+            TEST(t < num_threads);
+            TEST(record == next[t]);
+            next[t] += num_files;
+        }
+        TEST(content.eof());
+        for(size_t j = 0; j < num_threads; j++)
+            TEST(next[j] >= num_records);
+    }
+    TEST(files.close());
+    TEST(!files.close());
+    for(size_t i = 0; i < num_files; i++)
+        TEST(nw::remove(names[i].c_str()) == 0);
+}
+
+void test_errors(const std::string& prefix)
+{
+    nw::parallel_file_writer_options options;
+    options.buffer_size = 10;
+    {
+        nw::parallel_file_writer files(options);
+        TEST(!files.open(prefix + "-missing/file.txt"));
+        TEST(files.num_files() == 0u);
+        const std::string name = make_filename(prefix, 0);
+        TEST(files.open(name));
+        // Writer outliving close
+        nw::parallel_file_writer::writer writer(files);
+        TEST(writer.write(0, "Hello"));
+        TEST(writer.flush());
+        TEST(files.close());
+        TEST(!files.open(name));
+        TEST(!writer.write(0, "World, not written"));
+        TEST(read_file(name) == "Hello");
+        TEST(nw::remove(name.c_str()) == 0);
+    }
+#ifdef __linux__
+    {
+        nw::parallel_file_writer files(options);
+        TEST(files.open("/dev/full"));
+        {
+            nw::parallel_file_writer::writer writer(files);
+            for(int i = 0; i < 100000 && writer.write(0, "0123456789"); i++)
+            {}
+            TEST(!writer.write(0, "0123456789"));
+        }
+        TEST(!files.flush());
+        TEST(!files.close());
+    }
+#endif
+}
+
+int main(int, char** argv)
+{
+    const std::string prefix = argv[0];
+    try
+    {
+        const size_t buffer_sizes[] = {1, 7, 64 * 1024};
+        for(size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++)
+        {
+            std::cout << "Buffer size: " << buffer_sizes[i] << std::endl;
+            nw::parallel_file_writer_options options;
+            options.buffer_size = buffer_sizes[i];
+            test_write(prefix, options);
+            options.max_pending = 1;
+            test_write(prefix, options);
+        }
+        std::cout << "Errors" << std::endl;
+        test_errors(prefix);
+    } catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Ok" << std::endl;
+    return 0;
+}